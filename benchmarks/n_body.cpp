@@ -0,0 +1,78 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#include <cmath> // for sqrt
+
+#include "benchmark/benchmark.h"
+
+#include "samarium/math/BoundingBox.hpp"
+#include "samarium/physics/BarnesHut.hpp"
+#include "samarium/physics/ParticleSystem.hpp"
+#include "samarium/util/RandomGenerator.hpp"
+#include "samarium/util/ThreadPool.hpp"
+
+using namespace sm;
+
+// state.range(0) bodies scattered over a square, at the same density whatever the count
+static auto make_bodies(benchmark::State& state)
+{
+    const auto count = static_cast<u64>(state.range(0));
+    const auto width = std::sqrt(static_cast<f64>(count));
+    auto rand        = RandomGenerator{count * 2};
+    auto system      = ParticleSystem<>{count};
+    for (auto& particle : system)
+    {
+        particle.pos  = rand.vector(BoundingBox<f64>::square(width));
+        particle.mass = rand.range<f64>({0.5, 2.0});
+    }
+    return system;
+}
+
+static void bm_gravity_brute_force(benchmark::State& state)
+{
+    auto system = make_bodies(state);
+    for (auto _ : state)
+    {
+        for (auto& particle : system)
+        {
+            for (const auto& other : system)
+            {
+                const auto vec         = other.pos - particle.pos;
+                const auto distance_sq = vec.length_sq();
+                if (distance_sq == 0.0) { continue; }
+                particle.acc += vec * (other.mass / (distance_sq * std::sqrt(distance_sq)));
+            }
+        }
+        benchmark::DoNotOptimize(system.particles.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// state.range(1) is the opening angle in hundredths
+static void bm_apply_long_range_forces(benchmark::State& state)
+{
+    auto system      = make_bodies(state);
+    auto thread_pool = ThreadPool{};
+    const auto theta = static_cast<f64>(state.range(1)) / 100.0;
+
+    for (auto _ : state) { phys::apply_long_range_forces(system, 1.0, theta, thread_pool); }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(bm_gravity_brute_force)
+    ->Name("gravity, every pair")
+    ->Arg(10'000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_apply_long_range_forces)
+    ->Name("phys::apply_long_range_forces(ThreadPool&)")
+    ->ArgNames({"bodies", "theta_percent"})
+    ->Args({10'000, 50})
+    ->Args({100'000, 50})
+    ->Args({1'000'000, 50})
+    ->Args({1'000'000, 100})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
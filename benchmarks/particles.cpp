@@ -5,10 +5,25 @@
  * Project homepage: https://github.com/strangeQuark1041/samarium
  */
 
+#include <array>   // for array
+#include <cmath>   // for sqrt
+#include <limits>  // for numeric_limits
+#include <tuple>   // for ignore
+#include <utility> // for pair
+#include <vector>  // for vector
+
 #include "benchmark/benchmark.h"
 
 #include "samarium/physics/ParticleSystem.hpp"
+#include "samarium/physics/ParticleSystemSoA.hpp"
+#include "samarium/physics/Spring.hpp"
+#include "samarium/physics/SpringSystem.hpp"
+#include "samarium/physics/VerletList.hpp"
+#include "samarium/physics/XPBD.hpp"
+#include "samarium/physics/collision.hpp"
+#include "samarium/physics/pairwise.hpp"
 #include "samarium/util/RandomGenerator.hpp"
+#include "samarium/util/UniformGrid.hpp"
 
 using namespace sm;
 
@@ -40,5 +55,606 @@ static void bm_ParticleSystem_update_self_collision(benchmark::State& state)
     }
 }
 
+static void bm_ParticleSystem_self_collision_threaded(benchmark::State& state)
+{
+    auto rand        = RandomGenerator{};
+    auto thread_pool = ThreadPool{};
+    auto ps          = ParticleSystem{static_cast<u64>(state.range(0))};
+    const auto width = std::sqrt(static_cast<f64>(state.range(0)));
+    for (auto& p : ps)
+    {
+        p.pos    = rand.vector({{-width, -width}, {width, width}});
+        p.vel    = rand.polar_vector({0.0, 12.0});
+        p.radius = 0.5;
+    }
+
+    for (auto _ : state)
+    {
+        ps.self_collision(thread_pool);
+        ps.update(0.01);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename System> static void bm_ParticleSystem_layout_update(benchmark::State& state)
+{
+    using Vector_t  = typename System::Vector_t;
+    using Float     = typename Vector_t::value_type;
+    auto rand       = RandomGenerator{};
+    auto ps         = System(static_cast<u64>(state.range(0)));
+    const auto size = ps.size();
+    for (auto i : loop::end(size))
+    {
+        const auto vel = rand.polar_vector({0.0, 12.0}).template cast<Float>();
+        // operator[] of the AoS system returns a copy, and that of the SoA system a proxy
+        if constexpr (requires { ps.particles; }) { ps.particles[i].vel = vel; }
+        else { ps[i].vel = vel; }
+    }
+
+    for (auto _ : state)
+    {
+        ps.apply_force(Vector_t::make(0.0, -9.8));
+        ps.update(static_cast<Float>(0.01));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// candidate pairs of 100k particles from a grid, about a third of which collide
+static auto make_collision_pairs()
+{
+    auto rand        = RandomGenerator{};
+    auto particles   = std::vector<Particle<f64>>(100'000);
+    const auto width = std::sqrt(static_cast<f64>(particles.size())) / 2.0;
+    for (auto& p : particles)
+    {
+        p.pos    = rand.vector({{-width, -width}, {width, width}});
+        p.vel    = rand.polar_vector({0.0, 12.0});
+        p.radius = 0.5;
+    }
+
+    auto grid = UniformGrid<u32>{1.0};
+    grid.rebuild(particles | util::project_view(&Particle<f64>::pos));
+    auto pairs = std::vector<phys::IndexPair>{};
+    grid.for_each_pair([&](u32 i, u32 j) { pairs.push_back({i, j}); });
+    return std::pair{particles, pairs};
+}
+
+static void bm_collide_pairs_one_at_a_time(benchmark::State& state)
+{
+    const auto [initial, pairs] = make_collision_pairs();
+    auto particles              = initial;
+
+    for (auto _ : state)
+    {
+        particles  = initial;
+        auto count = u64{};
+        for (const auto& [i, j] : pairs) { count += phys::collide(particles[i], particles[j]); }
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(pairs.size()));
+}
+
+static void bm_collide_pairs_batched(benchmark::State& state)
+{
+    const auto [initial, pairs] = make_collision_pairs();
+    auto particles              = initial;
+
+    for (auto _ : state)
+    {
+        particles = initial;
+        benchmark::DoNotOptimize(phys::collide(std::span{particles}, std::span{pairs}));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(pairs.size()));
+}
+
+// a lattice of 20k resting particles with 10 moving through it, after it has had time to settle
+static void bm_ParticleSystem_settled(benchmark::State& state)
+{
+    using System        = ParticleSystem<Particle<f64>, 32, UniformGrid<u32>>;
+    constexpr auto side = 200UL;
+    auto rand           = RandomGenerator{};
+    auto ps             = System{side * side / 2, {.radius = 0.5}, 1.0};
+    for (auto i : loop::end(ps.size()))
+    {
+        ps.particles[i].pos =
+            Vector2{static_cast<f64>(i % side), static_cast<f64>(i / side)} * 1.05;
+    }
+    for (auto i : loop::end(10UL)) { ps.particles[i * 1000].vel = rand.polar_vector({5.0, 10.0}); }
+    if (state.range(0) != 0)
+    {
+        ps.activity.sleep_speed = 0.05;
+        ps.activity.sleep_steps = 30;
+    }
+
+    const auto tick = [&]
+    {
+        ps.self_collision();
+        ps.update(0.01);
+    };
+    for (auto i : loop::end(100UL))
+    {
+        std::ignore = i;
+        tick();
+    }
+
+    for (auto _ : state) { tick(); }
+    state.counters["active"] = static_cast<f64>(ps.active_count());
+    state.counters["asleep"] = static_cast<f64>(ps.asleep_count());
+}
+
+// a dense lattice with small random velocities, as in molecular dynamics. state.range(0) is 1 to
+// collide with a VerletList, which is rebuilt only every few steps
+static void bm_ParticleSystem_dense(benchmark::State& state)
+{
+    using System        = ParticleSystem<Particle<f64>, 32, UniformGrid<u32>>;
+    constexpr auto side = 300UL;
+    auto rand           = RandomGenerator{};
+    auto ps             = System{side * side, {.radius = 0.5}, 1.0};
+    for (auto i : loop::end(ps.size()))
+    {
+        ps.particles[i].pos =
+            Vector2{static_cast<f64>(i % side), static_cast<f64>(i / side)} * 1.05;
+        ps.particles[i].vel = rand.polar_vector({0.0, 1.0});
+    }
+
+    auto neighbor_list = VerletList<f64>{1.0, 0.3};
+    for (auto _ : state)
+    {
+        if (state.range(0) != 0) { ps.self_collision(neighbor_list); }
+        else { ps.self_collision(); }
+        ps.update(0.01);
+    }
+    state.counters["rebuilds"] = benchmark::Counter(static_cast<f64>(neighbor_list.rebuild_count),
+                                                    benchmark::Counter::kAvgIterations);
+}
+
+// a 16x16 cloth of stiff springs hanging from its top corners for 1 second
+template <typename Integrator> static auto simulate_cloth(u64 substeps)
+{
+    constexpr auto side = 16UL;
+    auto ps = ParticleSystem<Particle<f64>, 32, HashGrid<u32, 32>, Integrator>{side * side};
+    for (auto i : loop::end(side * side))
+    {
+        ps.particles[i].pos = {static_cast<f64>(i % side), -static_cast<f64>(i / side)};
+    }
+
+    // pinned particles can't be moved by any force
+    ps.particles[0].mass        = std::numeric_limits<f64>::infinity();
+    ps.particles[side - 1].mass = std::numeric_limits<f64>::infinity();
+
+    auto springs = std::vector<Spring<f64>>{};
+    for (auto i : loop::end(side * side))
+    {
+        if (i % side != side - 1)
+        {
+            springs.emplace_back(ps.particles[i], ps.particles[i + 1], 2000.0, 1.0);
+        }
+        if (i / side != side - 1)
+        {
+            springs.emplace_back(ps.particles[i], ps.particles[i + side], 2000.0, 1.0);
+        }
+    }
+
+    const auto apply_forces = [&](auto& system)
+    {
+        system.apply_force({0.0, -9.8});
+        for (auto& spring : springs) { spring.update(); }
+    };
+
+    const auto steps = 60UL * substeps;
+    const auto dt    = 1.0 / static_cast<f64>(steps);
+    for (auto step : loop::end(steps))
+    {
+        std::ignore = step;
+        ps.step(dt, apply_forces);
+    }
+    return ps.particles;
+}
+
+// fast particles in a box of thin walls for 1 second, at the fewest substeps (up to 64) which keep
+// them all inside. Each substep either collides with every wall after moving, or sweeps through
+// the walls
+template <bool Swept> static void bm_walls(benchmark::State& state)
+{
+    constexpr auto half_width = 10.0;
+    const auto walls          = BoundingBox<f64>::square(2.0 * half_width).line_segments();
+
+    auto rand    = RandomGenerator{};
+    auto initial = std::vector<Particle<f64>>(1000);
+    for (auto& particle : initial)
+    {
+        particle.pos    = rand.vector({{-9.0, -9.0}, {9.0, 9.0}});
+        particle.vel    = rand.polar_vector({50.0, 200.0});
+        particle.radius = 0.1;
+    }
+
+    const auto simulate = [&](u64 substeps)
+    {
+        auto particles = initial;
+        const auto dt  = 1.0 / static_cast<f64>(60UL * substeps);
+        for (auto step : loop::end(60UL * substeps))
+        {
+            std::ignore = step;
+            if constexpr (Swept) { phys::update_swept(std::span{particles}, walls, dt); }
+            else
+            {
+                for (auto& particle : particles)
+                {
+                    particle.update(dt);
+                    for (const auto& wall : walls) { phys::collide(particle, wall, dt); }
+                }
+            }
+        }
+        return particles;
+    };
+
+    const auto escaped = [&](const auto& particles)
+    {
+        auto count = 0UL;
+        for (const auto& particle : particles)
+        {
+            count += math::abs(particle.pos.x) > half_width ||
+                     math::abs(particle.pos.y) > half_width;
+        }
+        return count;
+    };
+
+    auto substeps = 1UL;
+    while (substeps < 64UL && escaped(simulate(substeps)) != 0) { substeps *= 2; }
+
+    for (auto _ : state) { benchmark::DoNotOptimize(simulate(substeps)); }
+    state.counters["substeps"] = static_cast<f64>(substeps);
+    state.counters["escaped"]  = static_cast<f64>(escaped(simulate(substeps)));
+}
+
+// a 354x354 cloth with structural and shear springs: about 500k springs
+static auto make_cloth()
+{
+    constexpr auto side = 354U;
+    auto rand           = RandomGenerator{};
+    auto particles      = std::vector<Particle<f64>>(side * side);
+    for (auto i : loop::end(side * side))
+    {
+        particles[i].pos = Vector2{static_cast<f64>(i % side), static_cast<f64>(i / side)} +
+                           rand.polar_vector({0.0, 0.1});
+    }
+
+    auto springs = SpringSystem<f64>{};
+    for (auto i : loop::end(side * side))
+    {
+        const auto x = i % side;
+        const auto y = i / side;
+        if (x != side - 1) { springs.add(particles, i, i + 1); }
+        if (y == side - 1) { continue; }
+        springs.add(particles, i, i + side);
+        if (x != side - 1) { springs.add(particles, i, i + side + 1); }
+        if (x != 0) { springs.add(particles, i, i + side - 1); }
+    }
+    return std::pair{particles, springs};
+}
+
+static void bm_Spring_update(benchmark::State& state)
+{
+    auto [particles, system] = make_cloth();
+    auto springs             = std::vector<Spring<f64>>{};
+    springs.reserve(system.size());
+    for (const auto& [i, j] : system.indices) { springs.emplace_back(particles[i], particles[j]); }
+
+    for (auto _ : state)
+    {
+        for (auto& spring : springs) { spring.update(); }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(springs.size()));
+}
+
+static void bm_SpringSystem_apply_forces(benchmark::State& state)
+{
+    auto [particles, springs] = make_cloth();
+    for (auto _ : state) { springs.apply_forces(particles); }
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(springs.size()));
+}
+
+static void bm_SpringSystem_apply_forces_threaded(benchmark::State& state)
+{
+    auto [particles, springs] = make_cloth();
+    auto thread_pool          = ThreadPool{};
+    springs.color();
+
+    for (auto _ : state) { springs.apply_forces(particles, thread_pool); }
+    state.counters["colors"]  = static_cast<f64>(springs.color_offsets.size() - 1);
+    state.counters["threads"] = static_cast<f64>(thread_pool.get_thread_count());
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(springs.size()));
+}
+
+// one 1/60 s frame of a cloth of about state.range(0) very stiff springs, at one step per frame
+static void bm_XPBD_solve(benchmark::State& state)
+{
+    using Cloth = ParticleSystem<Particle<f64>, 32, HashGrid<u32, 32>, phys::PositionVerlet<f64>>;
+
+    // a side x side grid has 2 * side * (side - 1) springs
+    const auto side =
+        static_cast<u32>(std::sqrt(static_cast<f64>(state.range(0)) / 2.0)) + 1U;
+
+    const auto make_cloth = [&]
+    {
+        auto cloth = Cloth{static_cast<u64>(side) * side};
+        for (auto i : loop::end(side * side))
+        {
+            cloth.particles[i].pos = {static_cast<f64>(i % side), -static_cast<f64>(i / side)};
+        }
+        cloth.particles[0].mass        = std::numeric_limits<f64>::infinity();
+        cloth.particles[side - 1].mass = std::numeric_limits<f64>::infinity();
+
+        auto springs = SpringSystem<f64>{};
+        for (auto i : loop::end(side * side))
+        {
+            if (i % side != side - 1) { springs.add(cloth.particles, i, i + 1, 1e6, 0.0); }
+            if (i / side != side - 1) { springs.add(cloth.particles, i, i + side, 1e6, 0.0); }
+        }
+        return std::pair{cloth, springs};
+    };
+
+    const auto time_delta = 1.0 / 60.0;
+    const auto step       = [&](Cloth& cloth, SpringSystem<f64>& springs, phys::XPBD<f64>& xpbd)
+    {
+        cloth.step(
+            time_delta, [](Cloth& system) { system.apply_force({0.0, -9.8}); },
+            [&](Cloth& system) { xpbd.solve(system.particles, springs, time_delta); });
+    };
+
+    auto [cloth, springs] = make_cloth();
+    auto xpbd             = phys::XPBD<f64>{.iterations = 10, .warm_start = 0.5};
+    for (auto _ : state) { step(cloth, springs, xpbd); }
+    state.counters["springs"] = static_cast<f64>(springs.size());
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(springs.size()));
+
+    // strain after 1 second from rest, whatever the number of iterations timed
+    auto [fresh, fresh_springs] = make_cloth();
+    auto fresh_xpbd             = phys::XPBD<f64>{.iterations = 10, .warm_start = 0.5};
+    for ([[maybe_unused]] auto frame : loop::end(60)) { step(fresh, fresh_springs, fresh_xpbd); }
+    state.counters["strain"] = phys::XPBD<f64>::max_strain(fresh.particles, fresh_springs);
+}
+
+struct TypedParticle : Particle<f64>
+{
+    u32 type{};
+};
+
+// particle life: 3 types which attract or repel each other, state.range(0) particles. With
+// Exhaustive, every particle queries its neighbours itself, so every pair is looked at twice
+template <bool Exhaustive> static void bm_particle_life(benchmark::State& state)
+{
+    const auto count = static_cast<u64>(state.range(0));
+    const auto width = std::sqrt(static_cast<f64>(count)) * 1.5;
+    auto rand        = RandomGenerator{count * 2};
+    auto thread_pool = ThreadPool{};
+    auto system      = ParticleSystem<TypedParticle, 32, UniformGrid<u32>>{
+        count, {}, UniformGrid<u32>{4.0}};
+    for (auto& particle : system)
+    {
+        particle.pos  = rand.vector(BoundingBox<f64>::square(width));
+        particle.type = rand.range<u32>({0, 2});
+    }
+
+    const auto forces = std::array<std::array<f64, 3>, 3>{
+        {{1.0, -0.5, 0.2}, {0.3, 0.8, -0.6}, {-0.4, 0.1, 0.5}}};
+    // repel closer than 1, then a force by type which fades out at 4
+    const auto kernel =
+        [&](TypedParticle& on, const TypedParticle& due_to, Vector2 vec, f64 distance)
+    {
+        const auto peak     = forces[on.type][due_to.type];
+        const auto strength = distance < 1.0 ? distance - 1.0 : peak * (1.0 - distance / 4.0);
+        on.acc += vec * (strength / distance);
+    };
+
+    for (auto _ : state)
+    {
+        if constexpr (Exhaustive)
+        {
+            system.rebuild_hash_grid();
+            for (auto& particle : system)
+            {
+                system.hash_grid.for_each_neighbor(
+                    particle.pos,
+                    [&](u32 j)
+                    {
+                        const auto& other = system.particles[j];
+                        const auto vec    = other.pos - particle.pos;
+                        const auto length = vec.length();
+                        if (&other != &particle && length < 4.0)
+                        {
+                            kernel(particle, other, vec, length);
+                        }
+                    });
+            }
+        }
+        else
+        {
+            phys::for_each_pair_within<phys::Symmetry::Asymmetric>(system, 4.0, kernel,
+                                                                   thread_pool);
+        }
+        system.update(0.001);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// positions of the same cloth, integrated with classical Runge-Kutta at 1024 steps per frame: a
+// reference which favours none of the integrators compared
+static auto reference_cloth()
+{
+    constexpr auto side  = 16UL;
+    constexpr auto count = side * side;
+    using State          = std::vector<Vector2>;
+
+    auto pos = State(count);
+    auto vel = State(count);
+    for (auto i : loop::end(count))
+    {
+        pos[i] = {static_cast<f64>(i % side), -static_cast<f64>(i / side)};
+    }
+
+    auto springs = std::vector<std::pair<u64, u64>>{};
+    for (auto i : loop::end(count))
+    {
+        if (i % side != side - 1) { springs.emplace_back(i, i + 1); }
+        if (i / side != side - 1) { springs.emplace_back(i, i + side); }
+    }
+
+    // as Spring::update() and gravity give, with the top corners pinned
+    const auto acceleration = [&](const State& positions, const State& velocities)
+    {
+        auto acc = State(count, Vector2{0.0, -9.8});
+        for (const auto& [a, b] : springs)
+        {
+            const auto vec    = positions[b] - positions[a];
+            const auto spring = (vec.length() - 1.0) * 2000.0;
+            const auto damp   = Vector2::dot(vec.normalized(), velocities[b] - velocities[a]);
+            const auto force  = vec.with_length(spring + damp);
+            acc[a] += force;
+            acc[b] -= force;
+        }
+        acc[0]        = Vector2{};
+        acc[side - 1] = Vector2{};
+        return acc;
+    };
+
+    const auto offset = [](const State& state, const State& rate, f64 time)
+    {
+        auto result = state;
+        for (auto i : loop::end(count)) { result[i] += rate[i] * time; }
+        return result;
+    };
+
+    const auto dt = 1.0 / (60.0 * 1024.0);
+    for ([[maybe_unused]] auto step : loop::end(60UL * 1024UL))
+    {
+        const auto acc1 = acceleration(pos, vel);
+        const auto pos2 = offset(pos, vel, dt / 2.0);
+        const auto vel2 = offset(vel, acc1, dt / 2.0);
+        const auto acc2 = acceleration(pos2, vel2);
+        const auto pos3 = offset(pos, vel2, dt / 2.0);
+        const auto vel3 = offset(vel, acc2, dt / 2.0);
+        const auto acc3 = acceleration(pos3, vel3);
+        const auto pos4 = offset(pos, vel3, dt);
+        const auto vel4 = offset(vel, acc3, dt);
+        const auto acc4 = acceleration(pos4, vel4);
+        for (auto i : loop::end(count))
+        {
+            pos[i] += (vel[i] + 2.0 * vel2[i] + 2.0 * vel3[i] + vel4[i]) * (dt / 6.0);
+            vel[i] += (acc1[i] + 2.0 * acc2[i] + 2.0 * acc3[i] + acc4[i]) * (dt / 6.0);
+        }
+    }
+    return pos;
+}
+
+template <typename Integrator> static void bm_ParticleSystem_integrator(benchmark::State& state)
+{
+    static const auto reference = reference_cloth();
+    const auto tolerance        = 1e-2;
+
+    const auto error = [&](const auto& particles)
+    {
+        auto max = 0.0;
+        for (auto i : loop::end(particles.size()))
+        {
+            max = math::max(max, math::distance(particles[i].pos, reference[i]));
+        }
+        return max;
+    };
+
+    // fewest substeps per 1/60 s frame that reach the tolerance
+    auto substeps = 1UL;
+    while (substeps < 1024UL && !(error(simulate_cloth<Integrator>(substeps)) < tolerance))
+    {
+        substeps *= 2;
+    }
+
+    for (auto _ : state) { benchmark::DoNotOptimize(simulate_cloth<Integrator>(substeps)); }
+    state.counters["substeps"] = static_cast<f64>(substeps);
+    state.counters["error"]    = error(simulate_cloth<Integrator>(substeps));
+}
+
 BENCHMARK(bm_ParticleSystem_update)->Name("ParticleSystem::update()");
 BENCHMARK(bm_ParticleSystem_update_self_collision)->Name("Particlesystem::self_collision()");
+
+BENCHMARK(bm_ParticleSystem_self_collision_threaded)
+    ->Name("ParticleSystem::self_collision(ThreadPool&)")
+    ->Arg(10'000)
+    ->Arg(100'000);
+
+BENCHMARK(bm_ParticleSystem_layout_update<ParticleSystem<>>)
+    ->Name("ParticleSystem::apply_force() + update(), AoS f64")
+    ->Arg(10'000)
+    ->Arg(100'000)
+    ->Arg(1'000'000);
+BENCHMARK(bm_ParticleSystem_layout_update<ParticleSystem<Particle<f32>>>)
+    ->Name("ParticleSystem::apply_force() + update(), AoS f32")
+    ->Arg(10'000)
+    ->Arg(100'000)
+    ->Arg(1'000'000);
+BENCHMARK(bm_ParticleSystem_layout_update<ParticleSystemSoA<>>)
+    ->Name("ParticleSystem::apply_force() + update(), SoA f64")
+    ->Arg(10'000)
+    ->Arg(100'000)
+    ->Arg(1'000'000);
+BENCHMARK(bm_ParticleSystem_layout_update<ParticleSystemSoA<f32>>)
+    ->Name("ParticleSystem::apply_force() + update(), SoA f32")
+    ->Arg(10'000)
+    ->Arg(100'000)
+    ->Arg(1'000'000);
+
+BENCHMARK(bm_ParticleSystem_settled)
+    ->Name("ParticleSystem::self_collision() + update(), settled, sleeping")
+    ->Arg(0)
+    ->Arg(1);
+
+BENCHMARK(bm_ParticleSystem_dense)
+    ->Name("ParticleSystem::self_collision() + update(), dense, Verlet list")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(bm_ParticleSystem_integrator<phys::SemiImplicitEuler>)
+    ->Name("ParticleSystem::step(), cloth, semi-implicit Euler")
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_ParticleSystem_integrator<phys::PositionVerlet<f64>>)
+    ->Name("ParticleSystem::step(), cloth, position Verlet")
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_ParticleSystem_integrator<phys::VelocityVerlet<f64>>)
+    ->Name("ParticleSystem::step(), cloth, velocity Verlet")
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(bm_walls<false>)
+    ->Name("phys::collide() with every wall, fast particles")
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_walls<true>)
+    ->Name("phys::update_swept(), fast particles")
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(bm_Spring_update)->Name("Spring::update(), 500k springs")->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_SpringSystem_apply_forces)
+    ->Name("SpringSystem::apply_forces(), 500k springs")
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_SpringSystem_apply_forces_threaded)
+    ->Name("SpringSystem::apply_forces(ThreadPool&), 500k springs")
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(bm_XPBD_solve)
+    ->Name("phys::XPBD::solve(), stiff cloth, 10 iterations")
+    ->Arg(10'000)
+    ->Arg(100'000)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(bm_particle_life<true>)
+    ->Name("particle life, every particle queries its neighbours")
+    ->Arg(100'000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_particle_life<false>)
+    ->Name("particle life, phys::for_each_pair_within(ThreadPool&)")
+    ->Arg(100'000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK(bm_collide_pairs_one_at_a_time)->Name("phys::collide(), one pair at a time");
+BENCHMARK(bm_collide_pairs_batched)->Name("phys::collide(), batch of pairs");
@@ -0,0 +1,127 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#include <cmath>  // for sqrt
+#include <limits> // for numeric_limits
+#include <vector> // for vector
+
+#include "benchmark/benchmark.h"
+
+#include "samarium/math/BoundingBox.hpp"
+#include "samarium/physics/Collider.hpp"
+#include "samarium/physics/ParticleSystem.hpp"
+#include "samarium/physics/RigidBodySystem.hpp"
+#include "samarium/physics/coupling.hpp"
+#include "samarium/util/RandomGenerator.hpp"
+#include "samarium/util/UniformGrid.hpp"
+
+using namespace sm;
+
+// a pyramid of state.range(0) rows of unit boxes on the ground
+static auto make_pyramid(benchmark::State& state)
+{
+    const auto rows = state.range(0);
+    auto system     = RigidBodySystem<f64>{};
+    system.gravity  = {0.0, -10.0};
+    system.add({.pos = {0.0, -0.5}, .mass = std::numeric_limits<f64>::infinity()},
+               Collider<f64>::box(4.0 * static_cast<f64>(rows), 1.0));
+
+    for (auto row = 0L; row < rows; row++)
+    {
+        const auto count = rows - row;
+        for (auto i = 0L; i < count; i++)
+        {
+            const auto x = static_cast<f64>(i) - static_cast<f64>(count - 1) / 2.0;
+            system.add({.pos = {x, static_cast<f64>(row) + 0.5}}, Collider<f64>::box(1.0, 1.0));
+        }
+    }
+    return system;
+}
+
+// state.range(1) is 1 to warm start the contact impulses
+static void bm_RigidBodySystem_pyramid(benchmark::State& state)
+{
+    auto system          = make_pyramid(state);
+    system.warm_starting = state.range(1) != 0;
+    const auto top       = system.bodies.back().pos;
+
+    // a 1/60 s frame per iteration. The top box only moves if the pyramid falls
+    for (auto _ : state) { system.step(1.0 / 60.0); }
+    state.counters["bodies"]    = static_cast<f64>(system.size());
+    state.counters["contacts"]  = static_cast<f64>(system.manifolds.size());
+    state.counters["top_drift"] = (system.bodies.back().pos - top).length();
+}
+
+using Sand = ParticleSystem<Particle<f64>, 32, UniformGrid<u32>>;
+
+// visits every particle for every body, as if there were no spatial index
+struct AllParticles
+{
+    std::vector<Particle<f64>>& particles;
+
+    void for_each_overlapping(const BoundingBox<f64>& /* box */, auto&& callable)
+    {
+        for (auto& particle : particles) { callable(particle); }
+    }
+};
+
+// state.range(0) particles and state.range(1) boxes, at the same density whatever the count
+template <bool UseIndex> static void bm_couple(benchmark::State& state)
+{
+    const auto particle_count = static_cast<u64>(state.range(0));
+    const auto body_count     = static_cast<u64>(state.range(1));
+    const auto width          = std::sqrt(static_cast<f64>(particle_count));
+    const auto region         = BoundingBox<f64>::square(width);
+    auto rand                 = RandomGenerator{particle_count * 2};
+
+    auto sand = Sand{particle_count, {.radius = 0.3}, UniformGrid<u32>{1.0}};
+    for (auto& particle : sand) { particle.pos = rand.vector(region); }
+    sand.reorder(math::Curve::Hilbert);
+    sand.self_collision();
+
+    auto bodies = RigidBodySystem<f64>{};
+    for (auto i : loop::end(body_count))
+    {
+        static_cast<void>(i);
+        bodies.add({.pos   = rand.vector(region),
+                    .vel   = {0.0, -5.0},
+                    .a_pos = rand.range<f64>({0.0, 3.0})},
+                   Collider<f64>::box(3.0, 1.0));
+    }
+
+    auto all          = AllParticles{sand.particles};
+    const auto couple = [&]
+    {
+        if constexpr (UseIndex) { return phys::couple(sand, bodies, 1.0 / 60.0); }
+        else { return phys::couple(all, bodies, 1.0 / 60.0); }
+    };
+
+    // the first frame pushes the particles out of the falling bodies, after which they only touch
+    const auto collisions = couple();
+    for (auto _ : state) { benchmark::DoNotOptimize(couple()); }
+    state.counters["collisions"] = static_cast<f64>(collisions);
+}
+
+BENCHMARK(bm_RigidBodySystem_pyramid)
+    ->Name("RigidBodySystem::step(), pyramid of boxes, 10 iterations")
+    ->ArgNames({"rows", "warm_start"})
+    ->Args({20, 0})
+    ->Args({20, 1})
+    ->Args({60, 1})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(bm_couple<false>)
+    ->Name("phys::couple(), every particle for every body")
+    ->ArgNames({"particles", "bodies"})
+    ->Args({100'000, 100})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_couple<true>)
+    ->Name("phys::couple(), particles near each body")
+    ->ArgNames({"particles", "bodies"})
+    ->Args({100'000, 100})
+    ->Args({1'000'000, 1'000})
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,345 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#include <cmath>  // for sqrt
+#include <vector> // for vector
+
+#include "benchmark/benchmark.h"
+
+#include "samarium/geometry/BVH.hpp"
+#include "samarium/physics/ParticleSystem.hpp"
+#include "samarium/physics/collision.hpp"
+#include "samarium/util/HashGrid.hpp"
+#include "samarium/util/RandomGenerator.hpp"
+#include "samarium/util/SweepAndPrune.hpp"
+#include "samarium/util/UniformGrid.hpp"
+
+using namespace sm;
+
+static constexpr auto point_count = 100'000UL;
+
+// state.range(0) is the average number of points per unit area, in hundredths
+static auto make_points(benchmark::State& state)
+{
+    const auto density    = static_cast<f64>(state.range(0)) / 100.0;
+    const auto half_width = std::sqrt(static_cast<f64>(point_count) / density) / 2.0;
+    auto rand             = RandomGenerator{point_count * 2};
+    auto points           = std::vector<Vector2>(point_count);
+    const auto box        = BoundingBox<f64>::square(2.0 * half_width);
+    for (auto& point : points) { point = rand.vector(box); }
+    return points;
+}
+
+template <typename Grid> static void bm_rebuild(benchmark::State& state)
+{
+    const auto points = make_points(state);
+    auto grid         = Grid{1.0};
+
+    for (auto _ : state)
+    {
+        grid.rebuild(points);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(point_count));
+}
+
+template <typename Grid> static void bm_rebuild_and_query(benchmark::State& state)
+{
+    const auto points = make_points(state);
+    auto grid         = Grid{1.0};
+
+    for (auto _ : state)
+    {
+        grid.rebuild(points);
+        auto sum = u64{};
+        for (const auto& point : points)
+        {
+            for (auto j : grid.neighbors(point)) { sum += j; }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(point_count));
+}
+
+template <typename Grid> static void bm_rebuild_and_visit(benchmark::State& state)
+{
+    const auto points = make_points(state);
+    auto grid         = Grid{1.0};
+
+    for (auto _ : state)
+    {
+        grid.rebuild(points);
+        auto sum = u64{};
+        for (const auto& point : points)
+        {
+            grid.for_each_neighbor(point, [&](auto j) { sum += j; });
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(point_count));
+}
+
+// every particle against its 3x3 cells: each pair is checked twice, plus once against itself
+template <typename Grid>
+static void bm_rebuild_and_visit_pairs_per_particle(benchmark::State& state)
+{
+    const auto points = make_points(state);
+    auto grid         = Grid{1.0};
+    auto pairs        = u64{};
+
+    for (auto _ : state)
+    {
+        grid.rebuild(points);
+        pairs = 0;
+        for (auto i : loop::end(static_cast<u32>(point_count)))
+        {
+            grid.for_each_neighbor(points[i], [&](u32 j) { pairs += i != j; });
+        }
+        benchmark::DoNotOptimize(pairs);
+    }
+    state.counters["pairs"] = static_cast<f64>(pairs);
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(point_count));
+}
+
+// each cell against itself and its forward neighbours: each pair is checked once
+template <typename Grid> static void bm_rebuild_and_visit_pairs_half_shell(benchmark::State& state)
+{
+    const auto points = make_points(state);
+    auto grid         = Grid{1.0};
+    auto pairs        = u64{};
+
+    for (auto _ : state)
+    {
+        grid.rebuild(points);
+        pairs = 0;
+        grid.for_each_pair([&](u32 /* i */, u32 /* j */) { pairs++; });
+        benchmark::DoNotOptimize(pairs);
+    }
+    state.counters["pairs"] = static_cast<f64>(pairs);
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(point_count));
+}
+
+template <typename SpatialIndex> static void bm_self_collision(benchmark::State& state)
+{
+    const auto points = make_points(state);
+    auto ps = ParticleSystem<Particle<f64>, 32, SpatialIndex>{point_count, {.radius = 0.5}, 1.0};
+    for (auto i : loop::end(point_count)) { ps.particles[i].pos = points[i]; }
+
+    auto checked = Dimensions{};
+    for (auto _ : state) { checked = ps.self_collision(); }
+    state.counters["pairs"]      = static_cast<f64>(checked.y);
+    state.counters["collisions"] = static_cast<f64>(checked.x);
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(point_count));
+}
+
+// after a long run, particles close in space are scattered through memory, as they are here where
+// positions are random. state.range(0) is 0 to leave them, 1 to reorder along the Z-order curve and
+// 2 along the Hilbert curve. Counts the mean distance in memory between the particles of a pair
+template <typename SpatialIndex> static void bm_self_collision_reordered(benchmark::State& state)
+{
+    constexpr auto count = 200'000UL;
+    const auto points    = [&]
+    {
+        auto rand      = RandomGenerator{count * 2};
+        auto points_   = std::vector<Vector2>(count);
+        const auto box = BoundingBox<f64>::square(std::sqrt(static_cast<f64>(count)));
+        for (auto& point : points_) { point = rand.vector(box); }
+        return points_;
+    }();
+
+    auto ps = ParticleSystem<Particle<f64>, 32, SpatialIndex>{count, {.radius = 0.5}, 1.0};
+    for (auto i : loop::end(count)) { ps.particles[i].pos = points[i]; }
+    if (state.range(0) == 1) { ps.reorder(math::Curve::Morton); }
+    if (state.range(0) == 2) { ps.reorder(math::Curve::Hilbert); }
+
+    for (auto _ : state) { benchmark::DoNotOptimize(ps.self_collision()); }
+
+    auto pairs = u64{};
+    auto gap   = u64{};
+    ps.hash_grid.for_each_pair(
+        [&](u32 i, u32 j)
+        {
+            pairs++;
+            gap += i > j ? i - j : j - i;
+        });
+    state.counters["mean gap"] = static_cast<f64>(gap) / static_cast<f64>(pairs);
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(count));
+}
+
+static void bm_reorder(benchmark::State& state)
+{
+    constexpr auto count = 200'000UL;
+    auto rand            = RandomGenerator{count * 2};
+    auto ps              = ParticleSystem<>{count, {.radius = 0.5}, 1.0};
+    const auto box       = BoundingBox<f64>::square(std::sqrt(static_cast<f64>(count)));
+    for (auto& particle : ps) { particle.pos = rand.vector(box); }
+    const auto shuffled = ps.particles;
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        ps.particles = shuffled;
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(ps.reorder());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(count));
+}
+
+// 10k moving particles with radii log-uniform over [0.05, 5], 100x apart, covering about a quarter
+// of the area. state.range(0) is the cell size in tenths: a grid needs cells as big as the largest
+// particle to find every collision, but then the smallest particles share cells with many others
+template <typename SpatialIndex> static void bm_self_collision_log_uniform(benchmark::State& state)
+{
+    constexpr auto count = 10'000UL;
+    const auto spacing   = static_cast<f64>(state.range(0)) / 10.0;
+    auto rand            = RandomGenerator{};
+    auto ps              = ParticleSystem<Particle<f64>, 32, SpatialIndex>{count, {}, spacing};
+    for (auto& particle : ps)
+    {
+        particle.pos    = rand.vector(BoundingBox<f64>::square(600.0));
+        particle.vel    = rand.polar_vector({0.0, 1.0});
+        particle.radius = std::exp(rand.range<f64>({std::log(0.05), std::log(5.0)}));
+    }
+
+    auto checked = Dimensions{};
+    for (auto _ : state)
+    {
+        checked = ps.self_collision();
+        ps.update(0.1);
+    }
+    state.counters["pairs"]      = static_cast<f64>(checked.y);
+    state.counters["collisions"] = static_cast<f64>(checked.x);
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(count));
+}
+
+// a maze on a square grid: each cell has a wall on its right or bottom side, at random.
+// state.range(0) is the number of walls
+static auto make_maze(benchmark::State& state)
+{
+    const auto side = static_cast<u64>(std::sqrt(static_cast<f64>(state.range(0))));
+    auto rand       = RandomGenerator{};
+    auto walls      = std::vector<LineSegment>{};
+    for (auto y : loop::end(side))
+    {
+        for (auto x : loop::end(side))
+        {
+            const auto corner   = Vector2{static_cast<f64>(x), static_cast<f64>(y)};
+            const auto opposite = corner + Vector2{1.0, 1.0};
+            const auto side_    = rand.boolean() ? Vector2{1.0, 0.0} : Vector2{0.0, 1.0};
+            walls.push_back({corner + side_, opposite});
+        }
+    }
+    return walls;
+}
+
+// 1000 particles moving through a maze, colliding with every wall or only those near them
+template <bool UseBVH> static void bm_maze_collision(benchmark::State& state)
+{
+    const auto walls = make_maze(state);
+    const auto side  = std::sqrt(static_cast<f64>(walls.size()));
+    const auto bvh   = BVH{walls};
+    const auto dt    = 0.01;
+
+    auto rand      = RandomGenerator{};
+    auto particles = std::vector<Particle<f64>>(1000);
+    for (auto& particle : particles)
+    {
+        particle.pos    = rand.vector({{0.0, 0.0}, {side, side}});
+        particle.vel    = rand.polar_vector({1.0, 5.0});
+        particle.radius = 0.1;
+    }
+
+    for (auto _ : state)
+    {
+        for (auto& particle : particles)
+        {
+            particle.update(dt);
+            if constexpr (UseBVH) { phys::collide(particle, bvh, dt); }
+            else
+            {
+                for (const auto& wall : walls) { phys::collide(particle, wall, dt); }
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(particles.size()));
+}
+
+// 0.1, 0.5, 1 and 4 points per unit area
+static void densities(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->Arg(10)->Arg(50)->Arg(100)->Arg(400);
+}
+
+BENCHMARK(bm_rebuild<HashGrid<u32>>)->Name("HashGrid::rebuild()")->Apply(densities);
+BENCHMARK(bm_rebuild<UniformGrid<u32>>)->Name("UniformGrid::rebuild()")->Apply(densities);
+
+BENCHMARK(bm_rebuild_and_query<HashGrid<u32>>)
+    ->Name("HashGrid::rebuild() + neighbors()")
+    ->Apply(densities);
+BENCHMARK(bm_rebuild_and_query<UniformGrid<u32>>)
+    ->Name("UniformGrid::rebuild() + neighbors()")
+    ->Apply(densities);
+
+BENCHMARK(bm_rebuild_and_visit<HashGrid<u32>>)
+    ->Name("HashGrid::rebuild() + for_each_neighbor()")
+    ->Apply(densities);
+BENCHMARK(bm_rebuild_and_visit<UniformGrid<u32>>)
+    ->Name("UniformGrid::rebuild() + for_each_neighbor()")
+    ->Apply(densities);
+
+BENCHMARK(bm_rebuild_and_visit_pairs_per_particle<HashGrid<u32>>)
+    ->Name("HashGrid pairs: per particle")
+    ->Apply(densities);
+BENCHMARK(bm_rebuild_and_visit_pairs_half_shell<HashGrid<u32>>)
+    ->Name("HashGrid pairs: half shell")
+    ->Apply(densities);
+BENCHMARK(bm_rebuild_and_visit_pairs_per_particle<UniformGrid<u32>>)
+    ->Name("UniformGrid pairs: per particle")
+    ->Apply(densities);
+BENCHMARK(bm_rebuild_and_visit_pairs_half_shell<UniformGrid<u32>>)
+    ->Name("UniformGrid pairs: half shell")
+    ->Apply(densities);
+
+BENCHMARK(bm_self_collision<HashGrid<u32, 32>>)
+    ->Name("ParticleSystem<HashGrid>::self_collision()")
+    ->Apply(densities);
+BENCHMARK(bm_self_collision<UniformGrid<u32>>)
+    ->Name("ParticleSystem<UniformGrid>::self_collision()")
+    ->Apply(densities);
+
+BENCHMARK(bm_self_collision_reordered<HashGrid<u32, 32>>)
+    ->Name("ParticleSystem<HashGrid>::self_collision(), reordered")
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(2);
+BENCHMARK(bm_self_collision_reordered<UniformGrid<u32>>)
+    ->Name("ParticleSystem<UniformGrid>::self_collision(), reordered")
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(2);
+BENCHMARK(bm_reorder)->Name("ParticleSystem::reorder(), Hilbert");
+
+BENCHMARK(bm_self_collision_log_uniform<HashGrid<u32, 32>>)
+    ->Name("ParticleSystem<HashGrid>::self_collision(), log-uniform radii")
+    ->Arg(10)
+    ->Arg(100);
+BENCHMARK(bm_self_collision_log_uniform<UniformGrid<u32>>)
+    ->Name("ParticleSystem<UniformGrid>::self_collision(), log-uniform radii")
+    ->Arg(10)
+    ->Arg(100);
+BENCHMARK(bm_self_collision_log_uniform<SweepAndPrune<u32>>)
+    ->Name("ParticleSystem<SweepAndPrune>::self_collision(), log-uniform radii")
+    ->Arg(10);
+
+BENCHMARK(bm_maze_collision<false>)
+    ->Name("phys::collide() with every wall of a maze")
+    ->Arg(1'000)
+    ->Arg(10'000);
+BENCHMARK(bm_maze_collision<true>)
+    ->Name("phys::collide() with a BVH of a maze")
+    ->Arg(1'000)
+    ->Arg(10'000);
@@ -0,0 +1,61 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#include <cmath> // for sqrt
+
+#include "benchmark/benchmark.h"
+
+#include "samarium/physics/ParticleSystem.hpp"
+#include "samarium/physics/SPH.hpp"
+#include "samarium/util/ThreadPool.hpp"
+#include "samarium/util/UniformGrid.hpp"
+
+using namespace sm;
+
+using Fluid = ParticleSystem<Particle<f64>, 32, UniformGrid<u32>>;
+
+// a square block of state.range(0) particles, 2 per smoothing length, falling under gravity
+template <bool Threaded> static void bm_SPH_step(benchmark::State& state)
+{
+    const auto count = static_cast<u64>(state.range(0));
+    const auto side  = static_cast<u64>(std::sqrt(static_cast<f64>(count)));
+    auto fluid       = Fluid{count, {.radius = 0.25}, UniformGrid<u32>{1.0}};
+    for (auto i : loop::end(count))
+    {
+        fluid.particles[i].pos = {0.5 * static_cast<f64>(i % side),
+                                  0.5 * static_cast<f64>(i / side)};
+    }
+
+    auto sph         = SPH<f64>{1.0};
+    sph.rest_density = 4.0;
+    sph.stiffness    = 1000.0;
+    auto thread_pool = ThreadPool{};
+
+    const auto apply_forces = [&](Fluid& system)
+    {
+        system.apply_force({0.0, -10.0});
+        if constexpr (Threaded) { sph.apply_forces(system, thread_pool); }
+        else { sph.apply_forces(system); }
+    };
+
+    for (auto _ : state) { fluid.step(1.0 / 960.0, apply_forces); }
+    state.counters["steps"]     = benchmark::Counter(static_cast<f64>(state.iterations()),
+                                                     benchmark::Counter::kIsRate);
+    state.counters["neighbors"] = static_cast<f64>(sph.neighbors.size()) / static_cast<f64>(count);
+}
+
+BENCHMARK(bm_SPH_step<false>)
+    ->Name("SPH::apply_forces() and ParticleSystem::step()")
+    ->Arg(50'000)
+    ->Arg(500'000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_SPH_step<true>)
+    ->Name("SPH::apply_forces(ThreadPool&) and ParticleSystem::step()")
+    ->Arg(50'000)
+    ->Arg(500'000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
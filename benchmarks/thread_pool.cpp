@@ -0,0 +1,126 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#include <cmath>  // for sqrt
+#include <vector> // for vector
+
+#include "benchmark/benchmark.h"
+
+#include "samarium/math/loop.hpp"
+#include "samarium/util/TaskGraph.hpp"
+#include "samarium/util/ThreadPool.hpp"
+
+using namespace sm;
+
+constexpr auto item_count = 100'000UL;
+
+// the first eighth of the items cost 50 times as much as the rest, like a corner of a scene where
+// all the collisions happen
+static auto cost(u64 index) { return index < item_count / 8 ? 2000UL : 40UL; }
+
+static void work(std::vector<f64>& out, u64 min, u64 max)
+{
+    for (auto i : loop::start_end(min, max))
+    {
+        auto value = static_cast<f64>(i);
+        for (auto step : loop::end(cost(i))) { value = std::sqrt(value + static_cast<f64>(step)); }
+        out[i] = value;
+    }
+}
+
+static void bm_skewed_serial(benchmark::State& state)
+{
+    auto out = std::vector<f64>(item_count);
+    for (auto _ : state) { work(out, 0UL, item_count); }
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(item_count));
+}
+
+// state.range(0) is 1 to split the items into one equal block per thread up front, as a pool with
+// a single queue does, instead of adaptively
+static void bm_skewed_parallel_for(benchmark::State& state)
+{
+    auto out          = std::vector<f64>(item_count);
+    auto thread_pool  = ThreadPool{};
+    const auto blocks = thread_pool.get_thread_count() + 1;
+    const auto grain  = state.range(0) != 0 ? (item_count + blocks - 1) / blocks : 0UL;
+
+    for (auto _ : state)
+    {
+        thread_pool.parallel_for(
+            0UL, item_count, [&](u64 min, u64 max) { work(out, min, max); }, grain);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(item_count));
+    state.counters["threads"] = static_cast<f64>(blocks);
+}
+
+// a frame of 4 stages: a parallel loop and 2 serial stages which don't depend on each other, then
+// a parallel loop which needs all 3
+struct Frame
+{
+    std::vector<f64> forces = std::vector<f64>(item_count);
+    std::vector<f64> walls  = std::vector<f64>(item_count / 8);
+    std::vector<f64> trails = std::vector<f64>(item_count / 8);
+    std::vector<f64> result = std::vector<f64>(item_count);
+
+    void apply_forces(ThreadPool& thread_pool)
+    {
+        thread_pool.parallel_for(0UL, item_count,
+                                 [&](u64 min, u64 max) { work(forces, min, max); });
+    }
+
+    void integrate(ThreadPool& thread_pool)
+    {
+        thread_pool.parallel_for(0UL, item_count,
+                                 [&](u64 min, u64 max) { work(result, min, max); });
+    }
+};
+
+static void bm_frame_barriers(benchmark::State& state)
+{
+    auto thread_pool = ThreadPool{};
+    auto frame       = Frame{};
+    for (auto _ : state)
+    {
+        frame.apply_forces(thread_pool);
+        work(frame.walls, 0UL, item_count / 8);
+        work(frame.trails, 0UL, item_count / 8);
+        frame.integrate(thread_pool);
+    }
+}
+
+static void bm_frame_task_graph(benchmark::State& state)
+{
+    auto thread_pool = ThreadPool{};
+    auto frame       = Frame{};
+    auto graph       = TaskGraph{};
+
+    const auto forces    = graph.add("forces", [&] { frame.apply_forces(thread_pool); });
+    const auto walls     = graph.add("walls", [&] { work(frame.walls, 0UL, item_count / 8); });
+    const auto trails    = graph.add("trails", [&] { work(frame.trails, 0UL, item_count / 8); });
+    const auto integrate = graph.add("integrate", [&] { frame.integrate(thread_pool); });
+    for (auto stage : {forces, walls, trails}) { graph.precede(stage, integrate); }
+
+    for (auto _ : state) { graph.run(thread_pool); }
+    for (const auto& node : graph.nodes) { state.counters[node.name] = node.seconds * 1000.0; }
+}
+
+BENCHMARK(bm_skewed_serial)->Name("skewed work, serial")->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_skewed_parallel_for)
+    ->Name("skewed work, ThreadPool::parallel_for()")
+    ->ArgName("static_blocks")
+    ->Arg(1)
+    ->Arg(0)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(bm_frame_barriers)
+    ->Name("frame, stages one after another")
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(bm_frame_task_graph)
+    ->Name("frame, TaskGraph")
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
@@ -74,6 +74,11 @@ function(set_compiler_options)
         -mpclmul
     )
 
+    if(USE_AVX2)
+        set(MSVC_OPTIONS ${MSVC_OPTIONS} /arch:AVX2)
+        set(COMMON_OPTIONS ${COMMON_OPTIONS} -mavx2)
+    endif()
+
     if(USE_UBSAN)
         set(MSVC_OPTIONS ${MSVC_OPTIONS} /fsanitize=address)
         set(COMMON_OPTIONS ${COMMON_OPTIONS} -fsanitize=undefined,address
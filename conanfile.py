@@ -39,7 +39,6 @@ class SamariumConan(ConanFile):
             "stb/cci.20220909",
             "tl-expected/20190710",
             "tl-function-ref/1.0.0",
-            "bshoshany-thread-pool/3.3.0",
             "unordered_dense/2.0.1",
             "svector/1.0.2",
             "glfw/3.3.8",
@@ -12,10 +12,8 @@ using namespace sm::literals;
 static constexpr auto particle_colors = std::to_array<Color>(
     {"#fb2238"_c, "#0771F2"_c, "#11F762"_c, "#FCDD45"_c, "#7F11CE"_c, "#F4661A"_c});
 
-struct MyParticle
+struct MyParticle : Particle<f64>
 {
-    Vector2 pos{};
-    Vector2 vel{};
     i32 color{};
 };
 
@@ -60,13 +58,14 @@ auto main() -> i32
                                                                 0, 0},
                                           Dimensions{2, 2}}};
     const auto points     = rand.poisson_disc_points(0.8, window.viewport(), 16);
-    auto particles        = std::vector<MyParticle>(points.size());
+    auto particles        = ParticleSystem<MyParticle>{points.size(), {}, interaction.max_distance};
+    auto thread_pool      = ThreadPool{};
     auto frame_count      = u64(0);
     print(points.size());
 
     for (auto i : loop::end(particles.size()))
     {
-        auto& particle = particles.at(i);
+        auto& particle = particles.particles.at(i);
         particle.pos   = points.at(i) * 0.8;
         particle.vel   = rand.polar_vector({0, 0});
         // particle.color = particle.pos.x < 0 ? 1 : 0;
@@ -84,28 +83,11 @@ auto main() -> i32
                 i.pos += i.vel * delta_time;
             }
 
-            auto grid = HashGrid<u64>{interaction.max_distance * 1.5};
-            for (auto i : loop::end(particles.size())) { grid.insert(particles.at(i).pos, i); }
-            for (auto i : loop::end(particles.size()))
-            {
-                auto& current = particles.at(i);
-                for (auto j : grid.neighbors(current.pos))
-                {
-                    if (i == j) { continue; }
-                    const auto& other = particles.at(j);
-                    const auto force  = interaction(current, other);
-                    // if (force != 0.0)
-                    // {
-                    //     auto bond_color = colors::crimson;
-                    //     if (force > 0) { bond_color = colors::springgreen; }
-                    //     draw::line_segment(window, {current.pos, other.pos},
-                    //                        bond_color.with_multiplied_alpha(0.1), 0.06);
-                    // }
-                }
-                // const auto radius_vector = window.mouse.pos - current.pos;
-                // current.vel += radius_vector.with_length(
-                //     interaction.force(current.color, 0, radius_vector.length()));
-            }
+            phys::for_each_pair_within<phys::Symmetry::Asymmetric>(
+                particles, interaction.max_distance,
+                [&](MyParticle& current, const MyParticle& other, Vector2 /* vec */,
+                    f64 /* distance */) { interaction(current, other); },
+                thread_pool);
         }
 
         for (const auto& i : particles)
@@ -7,4 +7,5 @@
 
 #pragma once
 
+#include "samarium/geometry/BVH.hpp"
 #include "samarium/geometry/Mesh.hpp"
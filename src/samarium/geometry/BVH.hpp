@@ -0,0 +1,458 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <algorithm> // for partition, nth_element
+#include <array>     // for array
+#include <cmath>     // for sqrt
+#include <limits>    // for numeric_limits
+#include <numeric>   // for iota
+#include <optional>  // for optional
+#include <span>      // for span
+#include <utility>   // for swap
+#include <vector>    // for vector
+
+#include "samarium/core/types.hpp"       // for f64, u32, u64
+#include "samarium/math/BoundingBox.hpp" // for BoundingBox
+#include "samarium/math/Vector2.hpp"     // for Vector2
+#include "samarium/math/loop.hpp"        // for end, start_end
+#include "samarium/math/math.hpp"        // for min, max
+#include "samarium/math/shapes.hpp"      // for LineSegment, Circle
+#include "samarium/math/vector_math.hpp" // for clamped_distance, project_clamped
+#include "samarium/util/SmallVector.hpp" // for SmallVector
+
+#include "Mesh.hpp" // for Mesh
+
+namespace sm
+{
+/**
+ * @brief               Static bounding volume hierarchy over line segments, such as the edges of a
+ * Mesh. Built top down with binned SAH splits into a flat array of nodes in depth first order
+ */
+struct BVH
+{
+    struct Node
+    {
+        BoundingBox<f64> box{};
+        u32 offset{}; // leaf: first segment. Inner node: the second child, the first follows it
+        u32 count{};  // segments in a leaf, 0 for inner nodes
+
+        [[nodiscard]] auto is_leaf() const noexcept { return count != 0; }
+    };
+
+    struct ClosestSegment
+    {
+        u32 index{};     // index of the segment in the range the BVH was built from
+        Vector2 point{}; // closest point on the segment
+        f64 distance{};
+    };
+
+    struct RayHit
+    {
+        u32 index{};     // index of the segment in the range the BVH was built from
+        Vector2 point{}; // where the ray crosses the segment
+        f64 time{};      // fraction of the ray, in [0, 1]
+    };
+
+    static constexpr auto bin_count = 12UL;
+
+    u32 max_leaf_size{4};
+    std::vector<Node> nodes{};
+    std::vector<LineSegment> segments{}; // segments in leaf order
+    std::vector<u32> indices{};          // original index of each segment
+
+    BVH() = default;
+
+    /**
+     * @param  segments_    Sized range of LineSegment, such as Mesh::edges_view()
+     */
+    template <typename Segments> explicit BVH(const Segments& segments_) { rebuild(segments_); }
+
+    explicit BVH(const Mesh& mesh) { rebuild(mesh.edges_view()); }
+
+    template <typename Segments> void rebuild(const Segments& segments_)
+    {
+        auto original = std::vector<LineSegment>{};
+        original.reserve(static_cast<u64>(segments_.size()));
+        for (const LineSegment& segment : segments_) { original.push_back(segment); }
+
+        const auto count = original.size();
+        indices.resize(count);
+        std::iota(indices.begin(), indices.end(), 0U);
+        nodes.clear();
+        nodes.reserve(2 * count);
+        if (count != 0) { build(original, 0U, static_cast<u32>(count)); }
+
+        segments.resize(count);
+        for (auto i : loop::end(count)) { segments[i] = original[indices[i]]; }
+    }
+
+    [[nodiscard]] auto size() const noexcept { return segments.size(); }
+
+    [[nodiscard]] auto empty() const noexcept { return segments.empty(); }
+
+    /**
+     * @brief               Call `callable(index, segment)` for every segment whose bounding box
+     * overlaps `box`
+     */
+    void for_each_in_box(const BoundingBox<f64>& box, auto&& callable) const
+    {
+        if (nodes.empty()) { return; }
+
+        auto stack = SmallVector<u32, 64>{};
+        stack.push_back(0U);
+        while (!stack.empty())
+        {
+            const auto index = stack.back();
+            const auto& node = nodes[index];
+            stack.pop_back();
+            if (!overlaps(node.box, box)) { continue; }
+
+            if (node.is_leaf())
+            {
+                for (auto i : loop::start_end(node.offset, node.offset + node.count))
+                {
+                    if (!overlaps(bounds_of(segments[i]), box)) { continue; }
+                    callable(indices[i], segments[i]);
+                }
+                continue;
+            }
+            stack.push_back(node.offset);
+            stack.push_back(index + 1);
+        }
+    }
+
+    /**
+     * @brief               Call `callable(index, segment)` for every segment within the circle
+     */
+    void for_each_in_circle(const Circle& circle, auto&& callable) const
+    {
+        const auto offset = Vector2::combine(circle.radius);
+        for_each_in_box({circle.centre - offset, circle.centre + offset},
+                        [&](u32 index, const LineSegment& segment)
+                        {
+                            if (math::clamped_distance(circle.centre, segment) <= circle.radius)
+                            {
+                                callable(index, segment);
+                            }
+                        });
+    }
+
+    /**
+     * @brief               Call `callable(query, index, segment)` for every segment within each
+     * of `circles`, where `query` is the index of the circle
+     */
+    void for_each_in_circle(std::span<const Circle> circles, auto&& callable) const
+    {
+        for (auto query : loop::end(circles.size()))
+        {
+            for_each_in_circle(circles[query], [&](u32 index, const LineSegment& segment)
+                               { callable(query, index, segment); });
+        }
+    }
+
+    /**
+     * @brief               The segment closest to `point`, if any is within `max_distance`
+     */
+    [[nodiscard]] auto closest(Vector2 point,
+                               f64 max_distance = std::numeric_limits<f64>::infinity()) const
+        -> std::optional<ClosestSegment>
+    {
+        if (nodes.empty()) { return std::nullopt; }
+
+        auto best    = std::optional<ClosestSegment>{};
+        auto best_sq = max_distance * max_distance;
+        auto stack   = SmallVector<u32, 64>{};
+        stack.push_back(0U);
+        while (!stack.empty())
+        {
+            const auto index = stack.back();
+            const auto& node = nodes[index];
+            stack.pop_back();
+            if (distance_sq(node.box, point) > best_sq) { continue; }
+
+            if (node.is_leaf())
+            {
+                for (auto i : loop::start_end(node.offset, node.offset + node.count))
+                {
+                    const auto& segment  = segments[i];
+                    const auto projected = segment.length_sq() == 0.0
+                                               ? segment.p1
+                                               : math::project_clamped(point, segment);
+                    const auto dist_sq   = math::distance_sq(point, projected);
+                    if (dist_sq > best_sq) { continue; }
+                    best_sq = dist_sq;
+                    best    = ClosestSegment{indices[i], projected, 0.0};
+                }
+                continue;
+            }
+
+            // visit the nearer child first, as it is more likely to shrink best_sq
+            auto near = index + 1;
+            auto far  = node.offset;
+            if (distance_sq(nodes[far].box, point) < distance_sq(nodes[near].box, point))
+            {
+                std::swap(near, far);
+            }
+            stack.push_back(far);
+            stack.push_back(near);
+        }
+
+        if (best) { best->distance = std::sqrt(best_sq); }
+        return best;
+    }
+
+    /**
+     * @brief               The closest segment to each of `points`
+     *
+     * @param  points
+     * @param  out          Same size as points
+     */
+    void closest(std::span<const Vector2> points,
+                 std::span<std::optional<ClosestSegment>> out,
+                 f64 max_distance = std::numeric_limits<f64>::infinity()) const
+    {
+        for (auto i : loop::end(points.size())) { out[i] = closest(points[i], max_distance); }
+    }
+
+    /**
+     * @brief               The first segment hit by a ray from `ray.p1` to `ray.p2`
+     */
+    [[nodiscard]] auto raycast(const LineSegment& ray) const -> std::optional<RayHit>
+    {
+        if (nodes.empty()) { return std::nullopt; }
+
+        const auto direction = ray.vector();
+        auto best            = std::optional<RayHit>{};
+        auto best_time       = 1.0;
+        auto stack           = SmallVector<u32, 64>{};
+        stack.push_back(0U);
+        while (!stack.empty())
+        {
+            const auto index = stack.back();
+            const auto& node = nodes[index];
+            stack.pop_back();
+            if (!ray_hits_box(ray.p1, direction, best_time, node.box)) { continue; }
+
+            if (node.is_leaf())
+            {
+                for (auto i : loop::start_end(node.offset, node.offset + node.count))
+                {
+                    const auto time = intersection_time(ray.p1, direction, segments[i]);
+                    if (!time || *time > best_time) { continue; }
+                    best_time = *time;
+                    best      = RayHit{indices[i], ray.p1 + direction * *time, *time};
+                }
+                continue;
+            }
+            stack.push_back(node.offset);
+            stack.push_back(index + 1);
+        }
+        return best;
+    }
+
+    /**
+     * @brief               The first segment hit by each of `rays`
+     *
+     * @param  rays
+     * @param  out          Same size as rays
+     */
+    void raycast(std::span<const LineSegment> rays, std::span<std::optional<RayHit>> out) const
+    {
+        for (auto i : loop::end(rays.size())) { out[i] = raycast(rays[i]); }
+    }
+
+  private:
+    struct Bin
+    {
+        BoundingBox<f64> box = empty_box();
+        u32 count{};
+    };
+
+    [[nodiscard]] static auto empty_box() noexcept -> BoundingBox<f64>
+    {
+        return BoundingBox<f64>{Vector2::combine(std::numeric_limits<f64>::max()),
+                                Vector2::combine(std::numeric_limits<f64>::lowest())};
+    }
+
+    [[nodiscard]] static auto merge(const BoundingBox<f64>& a, const BoundingBox<f64>& b) noexcept
+        -> BoundingBox<f64>
+    {
+        return BoundingBox<f64>{{math::min(a.min.x, b.min.x), math::min(a.min.y, b.min.y)},
+                                {math::max(a.max.x, b.max.x), math::max(a.max.y, b.max.y)}};
+    }
+
+    [[nodiscard]] static auto bounds_of(const LineSegment& segment) noexcept -> BoundingBox<f64>
+    {
+        return BoundingBox<f64>::find_min_max(segment.p1, segment.p2);
+    }
+
+    [[nodiscard]] static auto overlaps(const BoundingBox<f64>& a,
+                                       const BoundingBox<f64>& b) noexcept -> bool
+    {
+        return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y &&
+               b.min.y <= a.max.y;
+    }
+
+    // half the perimeter, the 2D analogue of surface area
+    [[nodiscard]] static auto cost_of(const BoundingBox<f64>& box) noexcept -> f64
+    {
+        return box.width() + box.height();
+    }
+
+    [[nodiscard]] static auto distance_sq(const BoundingBox<f64>& box, Vector2 point) noexcept
+        -> f64
+    {
+        const auto dx = math::max(math::max(box.min.x - point.x, point.x - box.max.x), 0.0);
+        const auto dy = math::max(math::max(box.min.y - point.y, point.y - box.max.y), 0.0);
+        return dx * dx + dy * dy;
+    }
+
+    // slab test, for the part of the ray before max_time
+    [[nodiscard]] static auto
+    ray_hits_box(Vector2 origin, Vector2 direction, f64 max_time, const BoundingBox<f64>& box)
+        -> bool
+    {
+        auto t_min = 0.0;
+        auto t_max = max_time;
+        for (auto axis : loop::end(2UL))
+        {
+            const auto start = axis == 0 ? origin.x : origin.y;
+            const auto speed = axis == 0 ? direction.x : direction.y;
+            const auto low   = axis == 0 ? box.min.x : box.min.y;
+            const auto high  = axis == 0 ? box.max.x : box.max.y;
+            if (speed == 0.0)
+            {
+                if (start < low || start > high) { return false; }
+                continue;
+            }
+            auto t1 = (low - start) / speed;
+            auto t2 = (high - start) / speed;
+            if (t1 > t2) { std::swap(t1, t2); }
+            t_min = math::max(t_min, t1);
+            t_max = math::min(t_max, t2);
+            if (t_min > t_max) { return false; }
+        }
+        return true;
+    }
+
+    // time along origin + direction * t at which it crosses the segment, if it does for t in [0, 1]
+    [[nodiscard]] static auto
+    intersection_time(Vector2 origin, Vector2 direction, const LineSegment& segment)
+        -> std::optional<f64>
+    {
+        const auto edge  = segment.vector();
+        const auto denom = Vector2::cross(direction, edge);
+        if (denom == 0.0) { return std::nullopt; } // parallel
+
+        const auto offset = segment.p1 - origin;
+        const auto time   = Vector2::cross(offset, edge) / denom;
+        const auto along  = Vector2::cross(offset, direction) / denom;
+        if (time < 0.0 || time > 1.0 || along < 0.0 || along > 1.0) { return std::nullopt; }
+        return time;
+    }
+
+    auto build(const std::vector<LineSegment>& original, u32 first, u32 count) -> u32
+    {
+        const auto centroid = [&](u32 index)
+        { return (original[index].p1 + original[index].p2) / 2.0; };
+
+        auto box          = empty_box();
+        auto centroid_box = empty_box();
+        for (auto i : loop::start_end(first, first + count))
+        {
+            const auto c = centroid(indices[i]);
+            box          = merge(box, bounds_of(original[indices[i]]));
+            centroid_box = merge(centroid_box, {c, c});
+        }
+
+        const auto node_index = static_cast<u32>(nodes.size());
+        nodes.push_back({box, first, count});
+        if (count <= max_leaf_size) { return node_index; }
+
+        // split along the longer axis of the centroids
+        const auto diagonal = centroid_box.diagonal();
+        const auto axis     = diagonal.x >= diagonal.y ? 0 : 1;
+        const auto low      = axis == 0 ? centroid_box.min.x : centroid_box.min.y;
+        const auto extent   = axis == 0 ? diagonal.x : diagonal.y;
+        if (extent <= 0.0) { return node_index; } // all centroids coincide: can't be split
+
+        const auto bin_of = [&](u32 index)
+        {
+            const auto c   = centroid(index);
+            const auto pos = axis == 0 ? c.x : c.y;
+            const auto bin = static_cast<u64>((pos - low) / extent * static_cast<f64>(bin_count));
+            return math::min(bin, bin_count - 1);
+        };
+
+        auto bins = std::array<Bin, bin_count>{};
+        for (auto i : loop::start_end(first, first + count))
+        {
+            auto& bin = bins[bin_of(indices[i])];
+            bin.box   = merge(bin.box, bounds_of(original[indices[i]]));
+            bin.count++;
+        }
+
+        // cost of splitting after each bin: sweep from the right, then from the left
+        auto right_costs = std::array<f64, bin_count>{};
+        auto right_box   = empty_box();
+        auto right_count = u32{};
+        for (auto bin = bin_count - 1; bin > 0; bin--)
+        {
+            right_box   = merge(right_box, bins[bin].box);
+            right_count += bins[bin].count;
+            right_costs[bin - 1] =
+                right_count == 0 ? 0.0 : static_cast<f64>(right_count) * cost_of(right_box);
+        }
+
+        auto best_split = bin_count;
+        auto best_cost  = std::numeric_limits<f64>::max();
+        auto left_box   = empty_box();
+        auto left_count = u32{};
+        for (auto bin : loop::end(bin_count - 1))
+        {
+            left_box   = merge(left_box, bins[bin].box);
+            left_count += bins[bin].count;
+            if (left_count == 0 || left_count == count) { continue; }
+
+            const auto cost = static_cast<f64>(left_count) * cost_of(left_box) + right_costs[bin];
+            if (cost < best_cost)
+            {
+                best_cost  = cost;
+                best_split = bin;
+            }
+        }
+
+        auto middle = first + count / 2;
+        if (best_split != bin_count)
+        {
+            const auto split =
+                std::partition(indices.begin() + first, indices.begin() + first + count,
+                               [&](u32 index) { return bin_of(index) <= best_split; });
+            middle = static_cast<u32>(split - indices.begin());
+        }
+        else
+        {
+            // every centroid fell in one bin: fall back to a median split
+            std::nth_element(indices.begin() + first, indices.begin() + middle,
+                             indices.begin() + first + count,
+                             [&](u32 a, u32 b)
+                             {
+                                 const auto ca = centroid(a);
+                                 const auto cb = centroid(b);
+                                 return axis == 0 ? ca.x < cb.x : ca.y < cb.y;
+                             });
+        }
+
+        nodes[node_index].count = 0U;
+        build(original, first, middle - first);
+        nodes[node_index].offset = build(original, middle, first + count - middle);
+        return node_index;
+    }
+};
+} // namespace sm
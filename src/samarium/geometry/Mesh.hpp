@@ -29,7 +29,7 @@ struct Mesh
     std::vector<Vertex> vertices{};
     std::vector<Edge> edges{};
 
-    auto edges_view()
+    auto edges_view() const
     {
         const auto get_line_segment = [this](const auto& edge) {
             return LineSegment{vertices[edge.v1], vertices[edge.v2]};
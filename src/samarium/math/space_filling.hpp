@@ -0,0 +1,89 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <utility> // for swap
+
+#include "samarium/core/types.hpp" // for u32, u64
+
+namespace sm::math
+{
+/**
+ * @brief               Position along a space filling curve through a square grid. Cells which are
+ * close along the curve are close in space
+ */
+enum class Curve
+{
+    Morton, // Z-order: cheap to compute, with occasional long jumps
+    Hilbert // no jumps, so slightly better locality
+};
+
+/**
+ * @brief               Spread the lower 16 bits of `x` out to the even bits
+ */
+[[nodiscard]] constexpr auto spread_bits(u32 x) noexcept
+{
+    x &= 0x0000FFFFU;
+    x = (x | (x << 8U)) & 0x00FF00FFU;
+    x = (x | (x << 4U)) & 0x0F0F0F0FU;
+    x = (x | (x << 2U)) & 0x33333333U;
+    x = (x | (x << 1U)) & 0x55555555U;
+    return x;
+}
+
+/**
+ * @brief               Index of the cell (x, y) along the Z-order curve, by interleaving the bits
+ * of x and y
+ *
+ * @param  x            Less than 2^16
+ * @param  y            Less than 2^16
+ */
+[[nodiscard]] constexpr auto morton_index(u32 x, u32 y) noexcept -> u32
+{
+    return spread_bits(x) | (spread_bits(y) << 1U);
+}
+
+/**
+ * @brief               Index of the cell (x, y) along the Hilbert curve through a 2^order by
+ * 2^order grid. The hilbert_curve example draws this curve
+ *
+ * @param  x            Less than 2^order
+ * @param  y            Less than 2^order
+ * @param  order        At most 16
+ */
+[[nodiscard]] constexpr auto hilbert_index(u32 x, u32 y, u32 order = 16U) noexcept -> u32
+{
+    auto index = u32{};
+    for (auto side = 1U << (order - 1U); side > 0U; side >>= 1U)
+    {
+        const auto right = (x & side) != 0U ? 1U : 0U;
+        const auto up    = (y & side) != 0U ? 1U : 0U;
+        index += side * side * ((3U * right) ^ up);
+
+        // rotate the quadrant so the curve inside it starts and ends at the right corners
+        if (up == 0U)
+        {
+            if (right == 1U)
+            {
+                x = side - 1U - (x & (side - 1U));
+                y = side - 1U - (y & (side - 1U));
+            }
+            std::swap(x, y);
+        }
+    }
+    return index;
+}
+
+/**
+ * @brief               Index of the cell (x, y) along `curve`, through a 2^16 by 2^16 grid
+ */
+[[nodiscard]] constexpr auto curve_index(Curve curve, u32 x, u32 y) noexcept -> u32
+{
+    return curve == Curve::Morton ? morton_index(x, y) : hilbert_index(x, y);
+}
+} // namespace sm::math
@@ -7,9 +7,22 @@
 
 #pragma once
 
+#include "samarium/physics/Activity.hpp"
+#include "samarium/physics/BarnesHut.hpp"
+#include "samarium/physics/Collider.hpp"
 #include "samarium/physics/Particle.hpp"
 #include "samarium/physics/ParticleSystem.hpp"
+#include "samarium/physics/ParticleSystemSoA.hpp"
 #include "samarium/physics/RigidBody.hpp"
+#include "samarium/physics/RigidBodySystem.hpp"
+#include "samarium/physics/SPH.hpp"
 #include "samarium/physics/Spring.hpp"
+#include "samarium/physics/SpringSystem.hpp"
+#include "samarium/physics/VerletList.hpp"
+#include "samarium/physics/XPBD.hpp"
 #include "samarium/physics/collision.hpp"
+#include "samarium/physics/contact.hpp"
+#include "samarium/physics/coupling.hpp"
+#include "samarium/physics/integrators.hpp"
+#include "samarium/physics/pairwise.hpp"
 #include "samarium/physics/gpu/ParticleSystem.hpp"
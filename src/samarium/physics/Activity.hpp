@@ -0,0 +1,144 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <algorithm>  // for sort, unique
+#include <array>      // for array
+#include <functional> // for greater
+#include <numeric>    // for iota
+#include <span>       // for span
+#include <vector>     // for vector
+
+#include "samarium/core/types.hpp"       // for f64, u32, u64
+#include "samarium/math/loop.hpp"        // for end
+#include "samarium/util/radix_sort.hpp" // for permute
+
+namespace sm::phys
+{
+/**
+ * @brief               Tracks which particles of a system are asleep. A particle slower than
+ * `sleep_speed` for `sleep_steps` consecutive updates falls asleep, and stays asleep until woken
+ *
+ * @tparam Float        Floating point type of the particles
+ */
+template <typename Float = f64> struct Activity
+{
+    Float sleep_speed{}; // sleeping is disabled while this is 0
+    u32 sleep_steps{60};
+
+    std::vector<u32> still_steps{}; // consecutive updates each particle has been slow for
+    std::vector<u32> awake{};       // indices of awake particles, in no particular order
+    std::vector<u32> asleep{};      // indices of sleeping particles, in no particular order
+    bool asleep_changed{true};      // if asleep changed since it was last acknowledged
+
+    [[nodiscard]] auto enabled() const noexcept { return sleep_speed > Float{0}; }
+
+    /**
+     * @brief               Wake everything if the number of particles changed
+     */
+    void resize(u64 size)
+    {
+        if (still_steps.size() == size) { return; }
+
+        still_steps.assign(size, 0U);
+        awake.resize(size);
+        std::iota(awake.begin(), awake.end(), 0U);
+        asleep.clear();
+        asleep_changed = true;
+    }
+
+    [[nodiscard]] auto settled(Float speed_sq) const noexcept
+    {
+        return speed_sq < sleep_speed * sleep_speed;
+    }
+
+    [[nodiscard]] auto is_asleep(u64 index) const noexcept
+    {
+        return still_steps[index] >= sleep_steps;
+    }
+
+    /**
+     * @brief               Record the speed of `awake[position]` after an update. Putting it to
+     * sleep replaces it with the last awake particle, so iterate `awake` backwards
+     *
+     * @param  position     Index into awake
+     * @param  speed_sq     Squared speed of the particle
+     * @return true         If the particle fell asleep
+     */
+    auto settle(u64 position, Float speed_sq) -> bool
+    {
+        const auto index = awake[position];
+        if (!settled(speed_sq))
+        {
+            still_steps[index] = 0U;
+            return false;
+        }
+
+        if (++still_steps[index] < sleep_steps) { return false; }
+
+        asleep.push_back(index);
+        awake[position] = awake.back();
+        awake.pop_back();
+        asleep_changed = true;
+        return true;
+    }
+
+    /**
+     * @brief               Wake sleeping particles
+     *
+     * @param  positions    Indices into asleep, may contain duplicates. Sorted in place
+     */
+    void wake(std::span<u32> positions)
+    {
+        std::sort(positions.begin(), positions.end(), std::greater<>{});
+        const auto last = std::unique(positions.begin(), positions.end());
+
+        // from the back, so that moving the last sleeper into a hole never moves one still to wake
+        for (auto iter = positions.begin(); iter != last; ++iter)
+        {
+            const auto index   = asleep[*iter];
+            still_steps[index] = 0U;
+            awake.push_back(index);
+            asleep[*iter] = asleep.back();
+            asleep.pop_back();
+        }
+        if (positions.begin() != last) { asleep_changed = true; }
+    }
+
+    /**
+     * @brief               Follow the particles to their new indices
+     *
+     * @param  new_index    New index of each particle
+     */
+    void reorder(std::span<const u32> new_index)
+    {
+        if (still_steps.size() != new_index.size()) { return; }
+
+        util::permute(still_steps, new_index);
+        for (auto& index : awake) { index = new_index[index]; }
+        for (auto& index : asleep) { index = new_index[index]; }
+        asleep_changed = true;
+    }
+
+    /**
+     * @brief               Wake a particle, if it is asleep
+     *
+     * @param  index        Index of the particle
+     */
+    void wake_particle(u64 index)
+    {
+        for (auto position : loop::end(asleep.size()))
+        {
+            if (asleep[position] != index) { continue; }
+            auto positions = std::array{static_cast<u32>(position)};
+            wake(positions);
+            return;
+        }
+    }
+};
+} // namespace sm::phys
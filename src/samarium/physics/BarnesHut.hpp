@@ -0,0 +1,366 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <algorithm> // for partition_point
+#include <cmath>     // for floor, sqrt
+#include <limits>    // for numeric_limits
+#include <span>      // for span
+#include <vector>    // for vector
+
+#include "samarium/core/types.hpp"         // for f64, u32, u64
+#include "samarium/math/Vector2.hpp"       // for Vector2, Vector2_t
+#include "samarium/math/loop.hpp"          // for end, start_end
+#include "samarium/math/math.hpp"          // for min, max
+#include "samarium/math/space_filling.hpp" // for morton_index
+#include "samarium/util/ThreadPool.hpp"    // for ThreadPool
+#include "samarium/util/radix_sort.hpp"    // for radix_sort
+
+namespace sm
+{
+/**
+ * @brief               Barnes-Hut quadtree, to approximate forces which act between every pair of
+ * particles, such as gravity, in O(N log N). A group of particles which looks small enough from a
+ * particle pulls on it as a single body at its centre of mass
+ *
+ * Bodies are sorted along a Morton curve, so every node covers a contiguous range of them. Nodes
+ * are stored depth first in one vector, each knowing where its subtree ends, so walking the tree
+ * needs neither pointers nor a stack
+ *
+ * @tparam Float        Floating point type of the particles
+ */
+template <typename Float = f64> struct BarnesHut
+{
+    using Vector_t = Vector2_t<Float>;
+
+    struct Body
+    {
+        Vector_t pos{};
+        Float mass{};
+    };
+
+    struct Node
+    {
+        Vector_t centre_of_mass{};
+        Float mass{};
+        Float size{}; // width of the square it covers
+        u32 first{};  // bodies[first] to bodies[last - 1] are inside it
+        u32 last{};
+        u32 next{}; // index after its subtree, so a leaf is followed by next
+    };
+
+    u32 leaf_capacity{8}; // most bodies in a node before it is split
+    Float softening{};    // added to every distance, so that close encounters stay finite
+
+    std::vector<Node> nodes{};  // depth first: nodes[0] is the root
+    std::vector<Body> bodies{}; // sorted along a Morton curve
+    std::vector<u32> order{};   // bodies[i] is particles[order[i]]
+
+    /**
+     * @brief               Build the tree over `particles`
+     *
+     * @param  particles    Sized range of particles with finite masses
+     */
+    void rebuild(const auto& particles)
+    {
+        prepare(particles, [](std::span<const u32> keys) { return util::radix_sort(keys); });
+        nodes.clear();
+        if (!bodies.empty()) { build(nodes, 0U, static_cast<u32>(bodies.size()), 0U); }
+    }
+
+    /**
+     * @brief               Build the tree over `particles` using multiple threads. The subtrees
+     * from the third level down are built concurrently, then copied into place under the top
+     */
+    void rebuild(const auto& particles, ThreadPool& thread_pool)
+    {
+        prepare(particles, [&](std::span<const u32> keys)
+                { return util::radix_sort(keys, thread_pool); });
+
+        // the buckets are the squares of the split level, in Morton order
+        constexpr auto bucket_count = 1UL << (2U * split_level);
+        constexpr auto bucket_shift = 32U - 2U * split_level;
+        bucket_starts.resize(bucket_count + 1);
+        const auto count = static_cast<u32>(bodies.size());
+        for (auto bucket : loop::end(bucket_count))
+        {
+            bucket_starts[bucket] =
+                partition_end(0U, count, [&](u32 key) { return (key >> bucket_shift) < bucket; });
+        }
+        bucket_starts[bucket_count] = count;
+
+        subtrees.resize(bucket_count);
+        const auto job = [&](auto min, auto max)
+        {
+            for (auto bucket : loop::start_end(min, max))
+            {
+                subtrees[bucket].clear();
+                const auto first = bucket_starts[bucket];
+                const auto last  = bucket_starts[bucket + 1];
+                if (first != last) { build(subtrees[bucket], first, last, split_level); }
+            }
+        };
+        thread_pool.parallel_for(0UL, bucket_count, job, 1UL);
+
+        nodes.clear();
+        assemble(0U, 0UL);
+    }
+
+    /**
+     * @brief               Acceleration of body i due to all the others, for a constant of 1
+     *
+     * @param  index        Index into bodies
+     * @param  theta        Opening angle: a node acts as one body if its size over its distance
+     * is less than this. 0 is exact, larger is faster and less accurate
+     */
+    [[nodiscard]] auto acceleration(u64 index, Float theta) const noexcept
+    {
+        const auto pos          = bodies[index].pos;
+        const auto theta_sq     = theta * theta;
+        const auto softening_sq = softening * softening;
+        const auto pull         = [&](Vector_t other, Float mass)
+        {
+            const auto vec         = other - pos;
+            const auto distance_sq = vec.length_sq() + softening_sq;
+            if (distance_sq == Float{0}) { return Vector_t{}; }
+            return vec * (mass / (distance_sq * std::sqrt(distance_sq)));
+        };
+
+        auto acc = Vector_t{};
+        auto i   = u64{};
+        while (i < nodes.size())
+        {
+            const auto& node   = nodes[i];
+            const auto outside = index < node.first || index >= node.last;
+            if (outside &&
+                node.size * node.size < theta_sq * (node.centre_of_mass - pos).length_sq())
+            {
+                acc += pull(node.centre_of_mass, node.mass);
+                i = node.next;
+            }
+            else if (node.next == i + 1)
+            {
+                for (auto j : loop::start_end(node.first, node.last))
+                {
+                    if (j != index) { acc += pull(bodies[j].pos, bodies[j].mass); }
+                }
+                i = node.next;
+            }
+            else { i++; }
+        }
+        return acc;
+    }
+
+    /**
+     * @brief               Add the acceleration due to every other particle to the acc of each
+     * particle, as of the last rebuild()
+     *
+     * @param  particles    As passed to rebuild()
+     * @param  constant     G for gravity. Negative constants repel
+     * @param  theta        Opening angle
+     */
+    void apply_forces(auto& particles, Float constant, Float theta) const
+    {
+        apply_forces(particles, constant, theta, 0UL, bodies.size());
+    }
+
+    /**
+     * @brief               Add the acceleration due to every other particle to the acc of each
+     * particle, using multiple threads
+     */
+    void apply_forces(auto& particles, Float constant, Float theta, ThreadPool& thread_pool) const
+    {
+        const auto job = [&](auto min, auto max)
+        { apply_forces(particles, constant, theta, min, max); };
+        thread_pool.parallel_for(0UL, bodies.size(), job);
+    }
+
+  private:
+    static constexpr auto max_level   = 16U; // the Morton keys have 16 bits per axis
+    static constexpr auto split_level = 3U;  // where the threaded rebuild() splits the tree
+
+    Float root_size{};
+    std::vector<u32> sorted_keys{};
+    std::vector<u32> bucket_starts{};
+    std::vector<std::vector<Node>> subtrees{};
+
+    // sort the particles into bodies by the Morton keys of their cells in the bounding square
+    void prepare(const auto& particles, auto&& sort_keys)
+    {
+        const auto count = static_cast<u64>(particles.size());
+        auto min         = Vector2::combine(std::numeric_limits<f64>::max());
+        auto max         = Vector2::combine(std::numeric_limits<f64>::lowest());
+        for (const auto& particle : particles)
+        {
+            const auto pos = static_cast<Vector2>(particle.pos);
+            min            = {math::min(min.x, pos.x), math::min(min.y, pos.y)};
+            max            = {math::max(max.x, pos.x), math::max(max.y, pos.y)};
+        }
+
+        // fall back to a unit square when all particles are in one spot, or too close for the
+        // scale to be finite
+        const auto extent = math::max(max.x - min.x, max.y - min.y);
+        const auto width  =
+            extent > 0.0 && 65535.0 / extent < std::numeric_limits<f64>::max() ? extent : 1.0;
+        const auto scale  = 65535.0 / width;
+        root_size         = static_cast<Float>(width);
+
+        auto keys = std::vector<u32>(count);
+        auto i    = u64{};
+        for (const auto& particle : particles)
+        {
+            const auto cell = (static_cast<Vector2>(particle.pos) - min) * scale;
+            keys[i++]       = math::morton_index(static_cast<u32>(std::floor(cell.x)),
+                                                 static_cast<u32>(std::floor(cell.y)));
+        }
+
+        order = sort_keys(std::span<const u32>{keys});
+        bodies.resize(count);
+        sorted_keys.resize(count);
+        for (auto j : loop::end(count))
+        {
+            const auto& particle = particles[order[j]];
+            bodies[j]            = {particle.pos, particle.mass};
+            sorted_keys[j]       = keys[order[j]];
+        }
+    }
+
+    [[nodiscard]] auto size_at(u32 level) const noexcept
+    {
+        return root_size / static_cast<Float>(1U << level);
+    }
+
+    // end of the leading bodies in [first, last) whose keys satisfy `predicate`
+    [[nodiscard]] auto partition_end(u32 first, u32 last, auto&& predicate) const
+    {
+        const auto keys  = std::span{sorted_keys}.subspan(first, last - first);
+        const auto count = std::partition_point(keys.begin(), keys.end(), predicate) - keys.begin();
+        return first + static_cast<u32>(count);
+    }
+
+    // append the subtree over bodies[first] to bodies[last - 1], whose keys share their first
+    // 2 * level bits
+    void build(std::vector<Node>& out, u32 first, u32 last, u32 level) const
+    {
+        const auto index = out.size();
+        out.push_back({.size = size_at(level), .first = first, .last = last});
+
+        if (last - first > leaf_capacity && level < max_level)
+        {
+            // the 2 bits after those decide the child
+            const auto shift = 2U * (max_level - 1U - level);
+            auto start       = first;
+            for (auto child : loop::end(4U))
+            {
+                const auto in_child = [&](u32 key) { return (key >> shift & 3U) <= child; };
+                const auto end      = partition_end(start, last, in_child);
+                if (end != start) { build(out, start, end, level + 1U); }
+                start = end;
+            }
+        }
+        finish(out, index);
+    }
+
+    // the top of the threaded rebuild(), over the buckets starting with `prefix`
+    void assemble(u32 level, u64 prefix)
+    {
+        const auto span  = 1UL << (2U * (split_level - level));
+        const auto first = bucket_starts[prefix * span];
+        const auto last  = bucket_starts[(prefix + 1) * span];
+        if (first == last) { return; }
+
+        if (level == split_level)
+        {
+            const auto offset = static_cast<u32>(nodes.size());
+            for (auto node : subtrees[prefix])
+            {
+                node.next += offset;
+                nodes.push_back(node);
+            }
+            return;
+        }
+
+        const auto index = nodes.size();
+        nodes.push_back({.size = size_at(level), .first = first, .last = last});
+        for (auto child : loop::end(4UL)) { assemble(level + 1U, prefix * 4 + child); }
+        finish(nodes, index);
+    }
+
+    // set the end and the centre of mass of node `index`, once its children are in `out`
+    void finish(std::vector<Node>& out, u64 index) const
+    {
+        auto& node = out[index];
+        node.next  = static_cast<u32>(out.size());
+
+        auto mass     = Float{};
+        auto weighted = Vector_t{};
+        if (node.next == index + 1)
+        {
+            for (auto j : loop::start_end(node.first, node.last))
+            {
+                mass += bodies[j].mass;
+                weighted += bodies[j].pos * bodies[j].mass;
+            }
+        }
+        else
+        {
+            for (auto child = index + 1; child < out.size(); child = out[child].next)
+            {
+                mass += out[child].mass;
+                weighted += out[child].centre_of_mass * out[child].mass;
+            }
+        }
+        node.mass           = mass;
+        node.centre_of_mass = mass > Float{0} ? weighted / mass : bodies[node.first].pos;
+    }
+
+    void apply_forces(auto& particles, Float constant, Float theta, u64 min, u64 max) const
+    {
+        for (auto i : loop::start_end(min, max))
+        {
+            particles[order[i]].acc += acceleration(i, theta) * constant;
+        }
+    }
+};
+
+namespace phys
+{
+/**
+ * @brief               Add the gravity of every particle on every other to their acc, with a
+ * BarnesHut tree
+ *
+ * @param  system       A ParticleSystem, whose particles all have finite masses
+ * @param  constant     G for gravity. Negative constants repel
+ * @param  theta        Opening angle, such as 0.5. 0 is exact, larger is faster and less accurate
+ */
+template <typename ParticleSystem_t>
+void apply_long_range_forces(ParticleSystem_t& system,
+                             typename ParticleSystem_t::Float constant,
+                             typename ParticleSystem_t::Float theta)
+{
+    auto tree = BarnesHut<typename ParticleSystem_t::Float>{};
+    tree.rebuild(system.particles);
+    tree.apply_forces(system.particles, constant, theta);
+}
+
+/**
+ * @brief               Add the gravity of every particle on every other to their acc, with a
+ * BarnesHut tree, using multiple threads for both building and walking it
+ */
+template <typename ParticleSystem_t>
+void apply_long_range_forces(ParticleSystem_t& system,
+                             typename ParticleSystem_t::Float constant,
+                             typename ParticleSystem_t::Float theta,
+                             ThreadPool& thread_pool)
+{
+    auto tree = BarnesHut<typename ParticleSystem_t::Float>{};
+    tree.rebuild(system.particles, thread_pool);
+    tree.apply_forces(system.particles, constant, theta, thread_pool);
+}
+} // namespace phys
+} // namespace sm
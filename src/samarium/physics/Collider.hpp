@@ -0,0 +1,120 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <algorithm> // for reverse
+#include <utility>   // for move
+#include <vector>    // for vector
+
+#include "samarium/core/types.hpp"   // for f64
+#include "samarium/math/Vector2.hpp" // for Vector2_t
+#include "samarium/math/loop.hpp"    // for end
+#include "samarium/math/math.hpp"    // for max, pi
+
+namespace sm
+{
+/**
+ * @brief               Shape of a RigidBody: a circle, or a convex polygon around the centre of
+ * mass of the body
+ *
+ * @tparam Float        Floating point type
+ */
+template <typename Float = f64> struct Collider
+{
+    std::vector<Vector2_t<Float>> vertices{}; // counter-clockwise, empty for a circle
+    Float radius{};                           // of a circle, or the furthest vertex from the centre
+
+    [[nodiscard]] static auto circle(Float radius_) { return Collider{{}, radius_}; }
+
+    /**
+     * @brief               Convex polygon, moved so its centroid is at the origin
+     *
+     * @param  vertices     In either winding order, at most 255 of them
+     */
+    [[nodiscard]] static auto polygon(std::vector<Vector2_t<Float>> vertices)
+    {
+        auto collider = Collider{std::move(vertices), Float{}};
+        if (collider.signed_area() < Float{0})
+        {
+            std::reverse(collider.vertices.begin(), collider.vertices.end());
+        }
+
+        const auto centroid = collider.centroid();
+        for (auto& vertex : collider.vertices)
+        {
+            vertex -= centroid;
+            collider.radius = math::max(collider.radius, vertex.length());
+        }
+        return collider;
+    }
+
+    [[nodiscard]] static auto box(Float width, Float height)
+    {
+        const auto x = width / Float{2};
+        const auto y = height / Float{2};
+        return polygon({{-x, -y}, {x, -y}, {x, y}, {-x, y}});
+    }
+
+    [[nodiscard]] auto is_circle() const noexcept { return vertices.empty(); }
+
+    [[nodiscard]] auto area() const noexcept
+    {
+        return is_circle() ? static_cast<Float>(math::pi) * radius * radius : signed_area();
+    }
+
+    /**
+     * @brief               Moment of inertia about the centre, for a uniform density
+     *
+     * @param  mass         Infinite for a static body, which gives an infinite moment
+     */
+    [[nodiscard]] auto inertia(Float mass) const noexcept
+    {
+        if (is_circle()) { return mass * radius * radius / Float{2}; }
+
+        // sum over the triangles from the centre to each edge
+        auto numerator   = Float{};
+        auto denominator = Float{};
+        for (auto i : loop::end(vertices.size()))
+        {
+            const auto a     = vertices[i];
+            const auto b     = vertices[(i + 1) % vertices.size()];
+            const auto cross = Vector2_t<Float>::cross(a, b);
+            numerator += cross * (Vector2_t<Float>::dot(a, a) + Vector2_t<Float>::dot(a, b) +
+                                  Vector2_t<Float>::dot(b, b));
+            denominator += cross;
+        }
+        return mass * numerator / (Float{6} * denominator);
+    }
+
+  private:
+    [[nodiscard]] auto signed_area() const noexcept
+    {
+        auto area = Float{};
+        for (auto i : loop::end(vertices.size()))
+        {
+            area += Vector2_t<Float>::cross(vertices[i], vertices[(i + 1) % vertices.size()]);
+        }
+        return area / Float{2};
+    }
+
+    [[nodiscard]] auto centroid() const noexcept
+    {
+        auto sum  = Vector2_t<Float>{};
+        auto area = Float{};
+        for (auto i : loop::end(vertices.size()))
+        {
+            const auto a     = vertices[i];
+            const auto b     = vertices[(i + 1) % vertices.size()];
+            const auto cross = Vector2_t<Float>::cross(a, b);
+            sum += (a + b) * cross;
+            area += cross;
+        }
+        return sum / (Float{3} * area);
+    }
+};
+} // namespace sm
@@ -15,6 +15,8 @@ namespace sm
 {
 template <typename Float = f64> struct Particle
 {
+    using value_type = Float;
+
     Vector2_t<Float> pos{};
     Vector2_t<Float> vel{};
     Vector2_t<Float> acc{};
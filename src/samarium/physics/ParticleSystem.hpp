@@ -7,39 +7,77 @@
 
 #pragma once
 
+#include <array>  // for array
+#include <atomic> // for atomic
+#include <cmath>  // for floor
 #include <concepts>
+#include <limits> // for numeric_limits
 #include <memory> // for allocator_trai...
 #include <span>   // for span
 #include <vector> // for vector
 
-#include "BS_thread_pool.hpp"                         // for multi_future
 #include "range/v3/algorithm/for_each.hpp"            // for for_each
 #include "range/v3/algorithm/sort.hpp"                // for sort
 #include "range/v3/functional/identity.hpp"           // for identity
 #include "range/v3/iterator/basic_iterator.hpp"       // for basic_iterator
 #include "range/v3/iterator/unreachable_sentinel.hpp" // for operator==
 #include "range/v3/view/enumerate.hpp"                // for enumerate, enu...
+#include "range/v3/view/transform.hpp"                // for transform
 #include "range/v3/view/view.hpp"                     // for view_closure
 #include "range/v3/view/zip.hpp"                      // for zip_view
 #include "range/v3/view/zip_with.hpp"                 // for iter_zip_with_...
 #include "tl/function_ref.hpp"                        // for function_ref
 
-#include "samarium/core/types.hpp"       // for f64, u64, usize
-#include "samarium/math/Extents.hpp"     // for Extents, range
-#include "samarium/math/Vector2.hpp"     // for Vector2
-#include "samarium/physics/Particle.hpp" // for Particle
-#include "samarium/util/HashGrid.hpp"    // for HashGrid
-#include "samarium/util/ThreadPool.hpp"  // for ThreadPool
-#include "samarium/util/util.hpp"        // for project_view
+#include "samarium/core/types.hpp"         // for f64, u64, usize
+#include "samarium/math/BoundingBox.hpp"   // for BoundingBox
+#include "samarium/math/Extents.hpp"       // for Extents, range
+#include "samarium/math/Vector2.hpp"       // for Vector2_t
+#include "samarium/math/space_filling.hpp" // for Curve, curve_index
+#include "samarium/physics/Particle.hpp"   // for Particle
+#include "samarium/util/HashGrid.hpp"      // for HashGrid
+#include "samarium/util/SweepAndPrune.hpp" // for SweepAndPrune
+#include "samarium/util/ThreadPool.hpp"    // for ThreadPool
+#include "samarium/util/UniformGrid.hpp"   // for UniformGrid
+#include "samarium/util/radix_sort.hpp"    // for radix_sort, invert_permutation
+#include "samarium/util/util.hpp"          // for project_view
 
-#include "collision.hpp" // for collide
+#include "Activity.hpp"    // for Activity
+#include "VerletList.hpp"  // for VerletList
+#include "collision.hpp"   // for collide
+#include "integrators.hpp" // for SemiImplicitEuler
 
 namespace sm
 {
-template <typename Particle_t = Particle<f64>, u64 CellCapacity = 32> struct ParticleSystem
+/**
+ * @brief               A collection of particles which can collide with each other
+ *
+ * @tparam Particle_t   Type of particle, such as Particle<f32> or Particle<f64>
+ * @tparam CellCapacity Max particles in one cell of the hash grid
+ * @tparam SpatialIndex Used to find neighbours: HashGrid, UniformGrid, or SweepAndPrune when radii
+ * vary a lot
+ * @tparam Integrator   Used by step(): phys::SemiImplicitEuler, phys::PositionVerlet or
+ * phys::VelocityVerlet
+ */
+template <typename Particle_t   = Particle<f64>,
+          u64 CellCapacity      = 32,
+          typename SpatialIndex = HashGrid<u32, CellCapacity>,
+          typename Integrator   = phys::SemiImplicitEuler>
+struct ParticleSystem
 {
+    using Float    = typename Particle_t::value_type;
+    using Vector_t = Vector2_t<Float>;
+
     std::vector<Particle_t> particles;
-    HashGrid<u32, CellCapacity> hash_grid;
+    SpatialIndex hash_grid;
+    Integrator integrator{};
+
+    /**
+     * @brief               Set `activity.sleep_speed` to let resting particles sleep: update(),
+     * apply_force() and self_collision() then only touch awake particles and their neighbours.
+     * step() still integrates every particle
+     */
+    phys::Activity<Float> activity{};
+    SpatialIndex asleep_grid; // sleeping particles, rebuilt only when they change
 
     /**
      * @brief               Create `size` particles
@@ -50,7 +88,20 @@ template <typename Particle_t = Particle<f64>, u64 CellCapacity = 32> struct Par
     explicit ParticleSystem(u64 size                           = 100UL,
                             const Particle_t& default_particle = {},
                             f64 cell_size                      = 0.5)
-        : particles(size, default_particle), hash_grid{cell_size}
+        : particles(size, default_particle), hash_grid{cell_size}, asleep_grid{hash_grid}
+    {
+    }
+
+    /**
+     * @brief               Create `size` particles, using a preconfigured spatial index
+     *
+     * @param  size
+     * @param  default_particle
+     * @param  spatial_index
+     */
+    ParticleSystem(u64 size, const Particle_t& default_particle, SpatialIndex spatial_index)
+        : particles(size, default_particle), hash_grid{std::move(spatial_index)},
+          asleep_grid{hash_grid}
     {
     }
 
@@ -65,35 +116,155 @@ template <typename Particle_t = Particle<f64>, u64 CellCapacity = 32> struct Par
         return output;
     }
 
-    void update(f64 time_delta = 1.0) noexcept
+    void update(Float time_delta = 1.0) noexcept
     {
-        ranges::for_each(particles,
-                         [time_delta](Particle_t& particle) { particle.update(time_delta); });
+        if (!activity.enabled())
+        {
+            ranges::for_each(particles,
+                             [time_delta](Particle_t& particle) { particle.update(time_delta); });
+            return;
+        }
+
+        activity.resize(particles.size());
+        for (auto position = activity.awake.size(); position-- > 0;)
+        {
+            auto& particle = particles[activity.awake[position]];
+            particle.update(time_delta);
+            if (activity.settle(position, particle.vel.length_sq())) { particle.vel = Vector_t{}; }
+        }
     }
 
-    void update(ThreadPool& thread_pool, f64 time_delta = 1.0) noexcept
+    void update(ThreadPool& thread_pool, Float time_delta = 1.0) noexcept
     {
+        if (!activity.enabled())
+        {
+            const auto job = [&](auto min, auto max)
+            {
+                for (auto i : loop::start_end(min, max)) { particles[i].update(time_delta); }
+            };
+
+            thread_pool.parallel_for(0UL, particles.size(), job);
+            return;
+        }
+
+        activity.resize(particles.size());
         const auto job = [&](auto min, auto max)
         {
-            for (auto i : loop::end(min, max)) { particles[i].update(time_delta); }
+            for (auto i : loop::start_end(min, max))
+            {
+                particles[activity.awake[i]].update(time_delta);
+            }
         };
+        thread_pool.parallel_for(0UL, activity.awake.size(), job);
+
+        for (auto position = activity.awake.size(); position-- > 0;)
+        {
+            auto& particle = particles[activity.awake[position]];
+            if (activity.settle(position, particle.vel.length_sq())) { particle.vel = Vector_t{}; }
+        }
+    }
 
-        thread_pool.parallelize_loop(0UL, particles.size(), job, thread_pool.get_thread_count())
-            .wait();
+    /**
+     * @brief               Advance the particles by `time_delta` with the integrator
+     *
+     * @param  time_delta
+     * @param  apply_forces Callable taking the ParticleSystem, which applies forces to the
+     * particles. Some integrators call it more than once per step
+     * @param  project_constraints Callable taking the ParticleSystem, which moves particles to
+     * satisfy constraints after they have moved
+     */
+    void step(Float time_delta, auto&& apply_forces, auto&& project_constraints)
+    {
+        integrator.step(std::span{particles}, time_delta, [&] { apply_forces(*this); },
+                        [&] { project_constraints(*this); });
     }
 
-    void apply_force(Vector2 force) noexcept
+    void step(Float time_delta, auto&& apply_forces)
     {
-        ranges::for_each(particles, [force](Particle_t& particle) { particle.apply_force(force); });
+        step(time_delta, apply_forces, [](ParticleSystem& /* system */) {});
     }
 
-    void apply_forces(std::span<Vector2> forces) noexcept
+    void apply_force(Vector_t force) noexcept
+    {
+        if (!activity.enabled())
+        {
+            ranges::for_each(particles,
+                             [force](Particle_t& particle) { particle.apply_force(force); });
+            return;
+        }
+
+        activity.resize(particles.size());
+        for (auto i : activity.awake) { particles[i].apply_force(force); }
+    }
+
+    /**
+     * @return u64          Number of particles which are awake. All of them if sleeping is disabled
+     */
+    [[nodiscard]] auto active_count() const noexcept
+    {
+        return activity.enabled() && activity.still_steps.size() == particles.size()
+                   ? activity.awake.size()
+                   : particles.size();
+    }
+
+    /**
+     * @return u64          Number of particles which are asleep
+     */
+    [[nodiscard]] auto asleep_count() const noexcept { return particles.size() - active_count(); }
+
+    void apply_forces(std::span<Vector_t> forces) noexcept
     {
         for (auto i : loop::end(particles.size())) { particles[i].apply_force(forces[i]); }
     }
 
     void for_each(const auto& callable) { ranges::for_each(particles, callable); }
 
+    /**
+     * @brief               Call `callable(particle)` for every particle which could overlap `box`,
+     * found with the spatial index as of the last self_collision(). Sleeping particles are found
+     * too, and woken if `callable` returns true
+     *
+     * @param  box          Grids find particles by their centre, so it is grown by the grid spacing
+     * @param  callable     Takes a Particle_t& and returns whether it moved the particle
+     */
+    void for_each_overlapping(BoundingBox<f64> box, auto&& callable)
+    {
+        if constexpr (!uses_radii)
+        {
+            const auto margin = Vector2::combine(hash_grid.spacing);
+            box               = {box.min - margin, box.max + margin};
+        }
+        hash_grid.for_each_overlapping(
+            box, [&](u32 index) { callable(particles[particle_index(index)]); });
+        if (!activity.enabled()) { return; }
+
+        update_asleep_grid();
+        auto woken = std::vector<u32>{};
+        asleep_grid.for_each_overlapping(
+            box,
+            [&](u32 position)
+            {
+                if (callable(particles[activity.asleep[position]])) { woken.push_back(position); }
+            });
+        activity.wake(woken);
+    }
+
+    /**
+     * @brief               Rebuild the spatial index from the positions of the particles, as
+     * self_collision() does. Without sleeping, its values are indices into particles
+     */
+    void rebuild_hash_grid()
+    {
+        if (!activity.enabled())
+        {
+            rebuild_index(hash_grid, particles);
+            return;
+        }
+
+        activity.resize(particles.size());
+        rebuild_index(hash_grid, activity.awake | ranges::views::transform(particle_at()));
+    }
+
     /**
      * @brief               Collide the particles with themselves
      *
@@ -104,27 +275,148 @@ template <typename Particle_t = Particle<f64>, u64 CellCapacity = 32> struct Par
      */
     [[maybe_unused]] auto self_collision(f64 damping = 1.0)
     {
-        hash_grid.map.clear();
-        hash_grid.map.reserve(particles.size());
-        for (auto i : loop::end(particles.size())) { hash_grid.insert(particles[i].pos, i); }
+        rebuild_hash_grid();
 
-        auto count1 = u32{};
-        auto count2 = u32{};
-        for (auto i : loop::end(particles.size()))
+        auto counts = Dimensions{};
+        hash_grid.for_each_cell([&](auto key, const auto& /* cell */)
+                                { counts += collide_cell(key, damping); });
+        if (activity.enabled()) { counts += collide_asleep(damping); }
+        return counts;
+    }
+
+    /**
+     * @brief               Collide the particles with themselves using multiple threads
+     *
+     * Cells are split into 9 batches by their coordinates modulo 3. The 3x3 neighbourhoods of 2
+     * cells in the same batch never overlap, so their pairs are resolved concurrently without
+     * races. Batches run one after the other, so the result is deterministic
+     *
+     * @param  thread_pool
+     * @param  damping      Coefficient of restitution
+     * @return Dimensions   [collisions, pairs checked]
+     */
+    [[maybe_unused]] auto self_collision(ThreadPool& thread_pool, f64 damping = 1.0)
+    {
+        rebuild_hash_grid();
+        fill_batches();
+
+        auto count1 = std::atomic<u64>{};
+        auto count2 = std::atomic<u64>{};
+        for (const auto& batch : batches)
         {
-            // Slow: for (auto j : loop::end(particles.size()))
-            // TODO bottleneck is still here, not in the actual collision
-            for (auto j : hash_grid.neighbors(particles[i].pos))
+            const auto job = [&](auto min, auto max)
             {
-                // we're looping through ordered pairs, so avoid colliding each pair twice
-                if (i < j)
+                auto counts = Dimensions{};
+                for (auto i : loop::start_end(min, max))
                 {
-                    count1 += phys::collide(particles[i], particles[j], damping);
-                    count2++;
+                    counts += collide_cell(batch[i], damping);
                 }
-            }
+                count1 += counts.x;
+                count2 += counts.y;
+            };
+
+            thread_pool.parallel_for(0UL, batch.size(), job);
         }
-        return Dimensions::make(count1, count2);
+
+        auto counts = Dimensions{count1.load(), count2.load()};
+        if (activity.enabled()) { counts += collide_asleep(damping); }
+        return counts;
+    }
+
+    /**
+     * @brief               Collide the particles with themselves, using a cached list of
+     * neighbours instead of the spatial index. The list is rebuilt only when particles have moved
+     * far enough, and sleeping is not used
+     *
+     * @param  neighbor_list With a cutoff of at least the largest sum of 2 radii
+     * @param  damping      Coefficient of restitution
+     * @return Dimensions   [collisions, pairs checked]
+     */
+    [[maybe_unused]] auto self_collision(VerletList<Float>& neighbor_list, f64 damping = 1.0)
+    {
+        neighbor_list.update(particles);
+
+        auto counts = Dimensions{};
+        neighbor_list.for_each_pair(particles,
+                                    [&](Particle_t& p1, Particle_t& p2)
+                                    {
+                                        counts.x += phys::collide(p1, p2, damping);
+                                        counts.y++;
+                                    });
+        return counts;
+    }
+
+    /**
+     * @brief               Call `callable(p1, p2)` once for every pair of awake particles in the
+     * same or adjacent cells of the spatial index, as of the last rebuild_hash_grid(). Pairs are
+     * found half-shell, so each is visited once and `callable` may change both particles
+     *
+     * @param  callable     Takes 2 Particle_t&
+     */
+    void for_each_pair(auto&& callable)
+    {
+        const auto pair = [&](u32 i, u32 j)
+        { callable(particles[particle_index(i)], particles[particle_index(j)]); };
+        hash_grid.for_each_pair(pair);
+    }
+
+    /**
+     * @brief               Call `callable(p1, p2)` once for every pair, using multiple threads.
+     * Cells are batched as in self_collision(), so `callable` may change both particles without
+     * locks, and calls never overlap on the same particle
+     *
+     * @param  thread_pool
+     * @param  callable     Takes 2 Particle_t&, and is called from several threads at once
+     */
+    void for_each_pair(ThreadPool& thread_pool, auto&& callable)
+    {
+        const auto pair = [&](u32 i, u32 j)
+        { callable(particles[particle_index(i)], particles[particle_index(j)]); };
+
+        fill_batches();
+        for (const auto& batch : batches)
+        {
+            const auto job = [&](auto min, auto max)
+            {
+                for (auto i : loop::start_end(min, max))
+                {
+                    hash_grid.for_each_pair(batch[i], pair);
+                }
+            };
+
+            thread_pool.parallel_for(0UL, batch.size(), job);
+        }
+    }
+
+    /**
+     * @brief               Sort the particles along a space filling curve through cells the size of
+     * the spatial index's spacing, so that particles close in space are close in memory. Moving
+     * particles drift apart in memory, so call this every so often
+     *
+     * References to particles, as held by Spring, refer to different particles afterwards
+     *
+     * @param  curve
+     * @return std::vector<u32> New index of each particle, to remap indices held elsewhere and to
+     * util::permute() per-particle data
+     */
+    auto reorder(math::Curve curve = math::Curve::Hilbert) -> std::vector<u32>
+    {
+        const auto keys = curve_keys(curve);
+        return apply_order(util::radix_sort(std::span<const u32>{keys}));
+    }
+
+    /**
+     * @brief               Sort the particles along a space filling curve using multiple threads
+     *
+     * @param  thread_pool
+     * @param  curve
+     * @return std::vector<u32> New index of each particle
+     */
+    auto reorder(ThreadPool& thread_pool, math::Curve curve = math::Curve::Hilbert)
+        -> std::vector<u32>
+    {
+        const auto keys = curve_keys(curve);
+        return apply_order(util::radix_sort(std::span<const u32>{keys}, thread_pool));
     }
 
     [[nodiscard]] auto operator[](u64 index) noexcept { return particles[index]; }
@@ -141,5 +433,162 @@ template <typename Particle_t = Particle<f64>, u64 CellCapacity = 32> struct Par
 
     [[nodiscard]] auto size() const noexcept { return particles.size(); }
     [[nodiscard]] auto empty() const noexcept { return particles.empty(); }
+
+  private:
+    // cells of the spatial index, split by their coordinates modulo 3 for the threaded passes.
+    // Kept between calls so that they don't allocate once they have grown
+    std::array<std::vector<typename SpatialIndex::Key>, 9> batches{};
+
+    void fill_batches()
+    {
+        for (auto& batch : batches) { batch.clear(); }
+        hash_grid.for_each_cell(
+            [&](typename SpatialIndex::Key key, const auto& /* cell */)
+            {
+                const auto batch = static_cast<u64>((key.x % 3 + 3) % 3 * 3 + (key.y % 3 + 3) % 3);
+                batches[batch].push_back(key);
+            });
+    }
+
+    /**
+     * @brief               Collide the pairs owned by one cell: those inside it and those with its
+     * forward (half-shell) neighbours, so that every pair is checked exactly once
+     *
+     * @return Dimensions   [collisions, pairs checked]
+     */
+    auto collide_cell(typename SpatialIndex::Key key, f64 damping)
+    {
+        auto counts         = Dimensions{};
+        const auto collide_ = [&](u32 i, u32 j)
+        {
+            auto& p1 = particles[particle_index(i)];
+            auto& p2 = particles[particle_index(j)];
+            counts.x += phys::collide(p1, p2, damping);
+            counts.y++;
+        };
+        hash_grid.for_each_pair(key, collide_);
+        return counts;
+    }
+
+    /**
+     * @brief               Collide awake particles with sleeping ones, waking those which are hit
+     * hard enough to move faster than the sleep speed
+     *
+     * @return Dimensions   [collisions, pairs checked]
+     */
+    auto collide_asleep(f64 damping)
+    {
+        update_asleep_grid();
+
+        auto counts = Dimensions{};
+        auto woken  = std::vector<u32>{};
+        for (auto i : activity.awake)
+        {
+            const auto collide_with = [&](u32 position)
+            {
+                auto& other = particles[activity.asleep[position]];
+                counts.y++;
+                if (!phys::collide(particles[i], other, damping)) { return; }
+                counts.x++;
+
+                // resting contacts don't wake
+                if (activity.settled(other.vel.length_sq()))
+                {
+                    other.vel = Vector_t{};
+                    return;
+                }
+                other.acc = Vector_t{};
+                woken.push_back(position);
+            };
+
+            const auto pos = static_cast<Vector2>(particles[i].pos);
+            if constexpr (uses_radii)
+            {
+                const auto half = Vector2::combine(static_cast<f64>(particles[i].radius));
+                asleep_grid.for_each_overlapping({pos - half, pos + half}, collide_with);
+            }
+            else { asleep_grid.for_each_neighbor(pos, collide_with); }
+        }
+        activity.wake(woken);
+        return counts;
+    }
+
+    void update_asleep_grid()
+    {
+        if (!activity.asleep_changed) { return; }
+        rebuild_index(asleep_grid, activity.asleep | ranges::views::transform(particle_at()));
+        activity.asleep_changed = false;
+    }
+
+    // with sleeping enabled, hash_grid only holds awake particles, by their index in activity.awake
+    [[nodiscard]] auto particle_index(u32 index) const noexcept
+    {
+        return activity.enabled() ? activity.awake[index] : index;
+    }
+
+    [[nodiscard]] auto particle_at() const noexcept
+    {
+        return [this](u32 index) -> const Particle_t& { return particles[index]; };
+    }
+
+    // SweepAndPrune sizes each particle by its radius, the grids use their cell size
+    static constexpr auto uses_radii = requires(SpatialIndex& index,
+                                                std::vector<Vector_t> positions,
+                                                std::vector<Float> radii) {
+        index.rebuild(positions, radii);
+    };
+
+    static void rebuild_index(SpatialIndex& index, const auto& particles_)
+    {
+        const auto positions = particles_ | util::project_view(&Particle_t::pos);
+        if constexpr (uses_radii)
+        {
+            index.rebuild(positions, particles_ | util::project_view(&Particle_t::radius));
+        }
+        else { index.rebuild(positions); }
+    }
+
+    // index along the curve of the cell of each particle, counting cells from the lowest one. Cells
+    // are the size of the spatial index's spacing, whether or not it has been built
+    [[nodiscard]] auto curve_keys(math::Curve curve) const -> std::vector<u32>
+    {
+        using Key  = Vector2_t<i32>;
+        auto cells = std::vector<Key>(particles.size());
+        auto first = Key::combine(std::numeric_limits<i32>::max());
+        for (auto i : loop::end(particles.size()))
+        {
+            const auto pos = static_cast<Vector2>(particles[i].pos) / hash_grid.spacing;
+            cells[i]       = Key::make(std::floor(pos.x), std::floor(pos.y));
+            first          = {math::min(first.x, cells[i].x), math::min(first.y, cells[i].y)};
+        }
+
+        // the curves cover 2^16 cells along each axis, which clamps only far away outliers
+        const auto coordinate = [](i32 value)
+        { return static_cast<u32>(math::min(static_cast<i64>(value), i64{0xFFFF})); };
+
+        auto keys = std::vector<u32>(particles.size());
+        for (auto i : loop::end(particles.size()))
+        {
+            const auto cell = cells[i] - first;
+            keys[i]         = math::curve_index(curve, coordinate(cell.x), coordinate(cell.y));
+        }
+        return keys;
+    }
+
+    // particles[i] = old particles[order[i]], and everything else which is per particle
+    auto apply_order(std::span<const u32> order) -> std::vector<u32>
+    {
+        auto sorted = std::vector<Particle_t>(particles.size());
+        for (auto i : loop::end(particles.size())) { sorted[i] = particles[order[i]]; }
+        particles.swap(sorted);
+
+        auto new_index = util::invert_permutation(order);
+        activity.reorder(new_index);
+        if constexpr (requires { integrator.reorder(std::span<const u32>{new_index}); })
+        {
+            integrator.reorder(new_index);
+        }
+        return new_index;
+    }
 };
 } // namespace sm
@@ -0,0 +1,434 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <concepts>    // for invocable
+#include <iterator>    // for forward_iterator_tag
+#include <optional>    // for optional
+#include <span>        // for span
+#include <type_traits> // for conditional_t, is_const_v, is_same_v
+#include <vector>      // for vector
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <immintrin.h> // for _mm_*, _mm256_*
+#endif
+
+#include "samarium/core/types.hpp"       // for f32, f64, u32, u64
+#include "samarium/math/Vector2.hpp"     // for Vector2_t, Dimensions
+#include "samarium/math/loop.hpp"        // for end
+#include "samarium/physics/Particle.hpp" // for Particle
+#include "samarium/util/HashGrid.hpp"    // for HashGrid
+#include "samarium/util/ThreadPool.hpp"  // for ThreadPool
+
+#include "collision.hpp" // for collide
+
+namespace sm
+{
+/**
+ * @brief               A pair of references into separate x and y arrays which behaves like a
+ * Vector2_t
+ *
+ * @tparam Float        Floating point type, const-qualified for read-only access
+ */
+template <typename Float> struct Vector2Ref
+{
+    using value_type = std::remove_const_t<Float>;
+
+    Float& x;
+    Float& y;
+
+    [[nodiscard]] constexpr auto value() const noexcept { return Vector2_t<value_type>{x, y}; }
+
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    [[nodiscard]] constexpr operator Vector2_t<value_type>() const noexcept { return value(); }
+
+    [[nodiscard]] constexpr auto length() const noexcept { return value().length(); }
+    [[nodiscard]] constexpr auto length_sq() const noexcept { return value().length_sq(); }
+
+    constexpr auto operator=(Vector2_t<value_type> rhs) noexcept -> Vector2Ref&
+        requires(!std::is_const_v<Float>)
+    {
+        x = rhs.x;
+        y = rhs.y;
+        return *this;
+    }
+
+    // assign through the references, never rebind them
+    constexpr auto operator=(const Vector2Ref& rhs) noexcept -> Vector2Ref&
+        requires(!std::is_const_v<Float>)
+    {
+        return *this = rhs.value();
+    }
+
+    constexpr auto operator+=(Vector2_t<value_type> rhs) noexcept -> Vector2Ref&
+        requires(!std::is_const_v<Float>)
+    {
+        x += rhs.x;
+        y += rhs.y;
+        return *this;
+    }
+
+    constexpr auto operator-=(Vector2_t<value_type> rhs) noexcept -> Vector2Ref&
+        requires(!std::is_const_v<Float>)
+    {
+        x -= rhs.x;
+        y -= rhs.y;
+        return *this;
+    }
+
+    constexpr auto operator*=(value_type rhs) noexcept -> Vector2Ref&
+        requires(!std::is_const_v<Float>)
+    {
+        x *= rhs;
+        y *= rhs;
+        return *this;
+    }
+
+    constexpr auto operator/=(value_type rhs) noexcept -> Vector2Ref&
+        requires(!std::is_const_v<Float>)
+    {
+        x /= rhs;
+        y /= rhs;
+        return *this;
+    }
+};
+
+/**
+ * @brief               Proxy for one particle of a ParticleSystemSoA, mirroring the members of
+ * Particle
+ *
+ * @tparam Float        Floating point type, const-qualified for read-only access
+ */
+template <typename Float> struct ParticleRef
+{
+    using value_type = std::remove_const_t<Float>;
+
+    Vector2Ref<Float> pos;
+    Vector2Ref<Float> vel;
+    Vector2Ref<Float> acc;
+    Float& radius;
+    Float& mass;
+
+    [[nodiscard]] constexpr auto value() const noexcept
+    {
+        return Particle<value_type>{pos.value(), vel.value(), acc.value(), radius, mass};
+    }
+
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    [[nodiscard]] constexpr operator Particle<value_type>() const noexcept { return value(); }
+
+    [[nodiscard]] constexpr auto as_circle() const noexcept { return value().as_circle(); }
+
+    constexpr auto operator=(const Particle<value_type>& particle) noexcept -> ParticleRef&
+        requires(!std::is_const_v<Float>)
+    {
+        pos    = particle.pos;
+        vel    = particle.vel;
+        acc    = particle.acc;
+        radius = particle.radius;
+        mass   = particle.mass;
+        return *this;
+    }
+
+    constexpr auto apply_force(Vector2_t<value_type> force) noexcept
+        requires(!std::is_const_v<Float>)
+    {
+        acc += force / mass;
+    }
+};
+
+/**
+ * @brief               A ParticleSystem which stores each member of its particles in a separate
+ * contiguous array (structure of arrays), so that loops only stream the members they touch
+ *
+ * @tparam Float        Floating point type of the particles. With f32, update() is explicitly
+ * vectorised
+ * @tparam CellCapacity Max particles in one cell of the hash grid
+ */
+template <typename Float = f64, u64 CellCapacity = 32> struct ParticleSystemSoA
+{
+    using Particle_t = Particle<Float>;
+    using Vector_t   = Vector2_t<Float>;
+
+    std::vector<Float> x;
+    std::vector<Float> y;
+    std::vector<Float> vx;
+    std::vector<Float> vy;
+    std::vector<Float> ax;
+    std::vector<Float> ay;
+    std::vector<Float> radius;
+    std::vector<Float> mass;
+    HashGrid<u32, CellCapacity> hash_grid;
+
+    /**
+     * @brief               Iterator yielding a ParticleRef which lives inside the iterator, so
+     * that `for (auto& particle : particle_system)` binds to an lvalue
+     */
+    template <bool IsConst> struct Iterator
+    {
+        using System = std::conditional_t<IsConst, const ParticleSystemSoA, ParticleSystemSoA>;
+        using Ref    = ParticleRef<std::conditional_t<IsConst, const Float, Float>>;
+
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = Ref;
+        using reference         = Ref&;
+
+        System* system{};
+        u64 index{};
+        mutable std::optional<Ref> ref{};
+
+        Iterator() = default;
+        Iterator(System* system_, u64 index_) noexcept : system{system_}, index{index_} {}
+
+        // the cached proxy refers to the old index, so never copy it
+        Iterator(const Iterator& other) noexcept : system{other.system}, index{other.index} {}
+        auto operator=(const Iterator& other) noexcept -> Iterator&
+        {
+            system = other.system;
+            index  = other.index;
+            ref.reset();
+            return *this;
+        }
+
+        auto operator*() const noexcept -> Ref&
+        {
+            ref.emplace(system->at(index));
+            return *ref;
+        }
+
+        auto operator->() const noexcept -> Ref* { return &**this; }
+
+        auto operator++() noexcept -> Iterator&
+        {
+            index++;
+            return *this;
+        }
+
+        auto operator++(int) noexcept -> Iterator
+        {
+            auto tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        [[nodiscard]] auto operator==(const Iterator& other) const noexcept -> bool
+        {
+            return index == other.index;
+        }
+    };
+
+    /**
+     * @brief               Create `size` particles
+     *
+     * @param  size
+     * @param  default_particle
+     */
+    explicit ParticleSystemSoA(u64 size                           = 100UL,
+                               const Particle_t& default_particle = {},
+                               f64 cell_size                      = 0.5)
+        : x(size, default_particle.pos.x), y(size, default_particle.pos.y),
+          vx(size, default_particle.vel.x), vy(size, default_particle.vel.y),
+          ax(size, default_particle.acc.x), ay(size, default_particle.acc.y),
+          radius(size, default_particle.radius), mass(size, default_particle.mass),
+          hash_grid{cell_size}
+    {
+    }
+
+    static auto generate(u64 size, const auto& callable)
+    {
+        auto output = ParticleSystemSoA(size);
+        for (auto i : loop::end(size)) { output.at(i) = callable(i); }
+        return output;
+    }
+
+    void update(Float time_delta = 1.0) noexcept { integrate(0UL, size(), time_delta); }
+
+    void update(ThreadPool& thread_pool, Float time_delta = 1.0) noexcept
+    {
+        const auto job = [&](auto min, auto max) { integrate(min, max, time_delta); };
+
+        thread_pool.parallel_for(0UL, size(), job);
+    }
+
+    void apply_force(Vector_t force) noexcept
+    {
+        for (auto i : loop::end(size())) { ax[i] += force.x / mass[i]; }
+        for (auto i : loop::end(size())) { ay[i] += force.y / mass[i]; }
+    }
+
+    void apply_forces(std::span<Vector_t> forces) noexcept
+    {
+        for (auto i : loop::end(size()))
+        {
+            ax[i] += forces[i].x / mass[i];
+            ay[i] += forces[i].y / mass[i];
+        }
+    }
+
+    /**
+     * @brief               Call `callable` on every particle. If it cannot take a ParticleRef,
+     * each particle is copied into a Particle and written back afterwards
+     *
+     * @param  callable     Callable taking a ParticleRef& or a Particle&
+     */
+    void for_each(const auto& callable)
+    {
+        using Ref = ParticleRef<Float>;
+        for (auto i : loop::end(size()))
+        {
+            auto ref = at(i);
+            if constexpr (std::invocable<decltype(callable), Ref&>) { callable(ref); }
+            else
+            {
+                auto particle = ref.value();
+                callable(particle);
+                ref = particle;
+            }
+        }
+    }
+
+    /**
+     * @brief               Collide the particles with themselves
+     *
+     * @param  damping      Coefficient of restitution
+     * @return Dimensions   [collisions, pairs checked]
+     */
+    [[maybe_unused]] auto self_collision(Float damping = 1.0)
+    {
+        hash_grid.map.clear();
+        hash_grid.map.reserve(size());
+        for (auto i : loop::end(static_cast<u32>(size()))) { hash_grid.insert(position(i), i); }
+
+        auto count1 = u32{};
+        auto count2 = u32{};
+        for (auto i : loop::end(static_cast<u32>(size())))
+        {
+            for (auto j : hash_grid.neighbors(position(i)))
+            {
+                // we're looping through ordered pairs, so avoid colliding each pair twice
+                if (i < j)
+                {
+                    auto p1 = at(i).value();
+                    auto p2 = at(j).value();
+                    if (phys::collide(p1, p2, damping))
+                    {
+                        // only velocities are changed by a collision
+                        at(i).vel = p1.vel;
+                        at(j).vel = p2.vel;
+                        count1++;
+                    }
+                    count2++;
+                }
+            }
+        }
+        return Dimensions::make(count1, count2);
+    }
+
+    void push_back(const Particle_t& particle)
+    {
+        x.push_back(particle.pos.x);
+        y.push_back(particle.pos.y);
+        vx.push_back(particle.vel.x);
+        vy.push_back(particle.vel.y);
+        ax.push_back(particle.acc.x);
+        ay.push_back(particle.acc.y);
+        radius.push_back(particle.radius);
+        mass.push_back(particle.mass);
+    }
+
+    [[nodiscard]] auto at(u64 index) noexcept
+    {
+        return ParticleRef<Float>{
+            {x[index], y[index]}, {vx[index], vy[index]}, {ax[index], ay[index]}, radius[index],
+            mass[index]};
+    }
+
+    [[nodiscard]] auto at(u64 index) const noexcept
+    {
+        return ParticleRef<const Float>{
+            {x[index], y[index]}, {vx[index], vy[index]}, {ax[index], ay[index]}, radius[index],
+            mass[index]};
+    }
+
+    [[nodiscard]] auto operator[](u64 index) noexcept { return at(index); }
+    [[nodiscard]] auto operator[](u64 index) const noexcept { return at(index); }
+
+    [[nodiscard]] auto begin() noexcept { return Iterator<false>{this, 0UL}; }
+    [[nodiscard]] auto end() noexcept { return Iterator<false>{this, size()}; }
+
+    [[nodiscard]] auto begin() const noexcept { return Iterator<true>{this, 0UL}; }
+    [[nodiscard]] auto end() const noexcept { return Iterator<true>{this, size()}; }
+
+    [[nodiscard]] auto cbegin() const noexcept { return Iterator<true>{this, 0UL}; }
+    [[nodiscard]] auto cend() const noexcept { return Iterator<true>{this, size()}; }
+
+    [[nodiscard]] auto size() const noexcept { return x.size(); }
+    [[nodiscard]] auto empty() const noexcept { return x.empty(); }
+
+  private:
+    [[nodiscard]] auto position(u64 index) const noexcept
+    {
+        return Vector2{static_cast<f64>(x[index]), static_cast<f64>(y[index])};
+    }
+
+    void integrate(u64 min, u64 max, Float time_delta) noexcept
+    {
+        // one pass per axis, so each loop streams exactly 3 arrays
+        integrate_axis(x.data(), vx.data(), ax.data(), min, max, time_delta);
+        integrate_axis(y.data(), vy.data(), ay.data(), min, max, time_delta);
+    }
+
+    static void integrate_axis(
+        Float* pos, Float* vel, Float* acc, u64 min, u64 max, Float time_delta) noexcept
+    {
+        auto i = min;
+
+        // compilers vectorise the scalar loop for f64 on their own, but not reliably for f32
+#if defined(__AVX__)
+        if constexpr (std::is_same_v<Float, f32>)
+        {
+            const auto dt   = _mm256_set1_ps(time_delta);
+            const auto zero = _mm256_setzero_ps();
+            for (; i + 8 <= max; i += 8)
+            {
+                const auto new_vel = _mm256_add_ps(_mm256_loadu_ps(vel + i),
+                                                   _mm256_mul_ps(_mm256_loadu_ps(acc + i), dt));
+                const auto new_pos =
+                    _mm256_add_ps(_mm256_loadu_ps(pos + i), _mm256_mul_ps(new_vel, dt));
+                _mm256_storeu_ps(vel + i, new_vel);
+                _mm256_storeu_ps(pos + i, new_pos);
+                _mm256_storeu_ps(acc + i, zero);
+            }
+        }
+#elif defined(__SSE__) || defined(_M_X64)
+        if constexpr (std::is_same_v<Float, f32>)
+        {
+            const auto dt   = _mm_set1_ps(time_delta);
+            const auto zero = _mm_setzero_ps();
+            for (; i + 4 <= max; i += 4)
+            {
+                const auto new_vel =
+                    _mm_add_ps(_mm_loadu_ps(vel + i), _mm_mul_ps(_mm_loadu_ps(acc + i), dt));
+                const auto new_pos = _mm_add_ps(_mm_loadu_ps(pos + i), _mm_mul_ps(new_vel, dt));
+                _mm_storeu_ps(vel + i, new_vel);
+                _mm_storeu_ps(pos + i, new_pos);
+                _mm_storeu_ps(acc + i, zero);
+            }
+        }
+#endif
+
+        for (; i < max; i++)
+        {
+            vel[i] += acc[i] * time_delta;
+            pos[i] += vel[i] * time_delta;
+            acc[i] = Float{}; // reset acceleration
+        }
+    }
+};
+} // namespace sm
@@ -8,40 +8,72 @@
 #pragma once
 
 #include "samarium/core/types.hpp"   // for f64
-#include "samarium/math/Vector2.hpp" // for Vector2, operator*, operator/
+#include "samarium/math/Vector2.hpp" // for Vector2_t, operator*, operator/
 
 namespace sm
 {
-struct RigidBody
+/**
+ * @brief               Position and motion of a rigid body. RigidBodySystem gives it a shape and
+ * makes it collide
+ *
+ * @tparam Float        Floating point type
+ */
+template <typename Float = f64> struct RigidBody
 {
-    Vector2 pos{};
-    Vector2 vel{};
-    Vector2 acc{};
-    f64 mass{1};
+    using value_type = Float;
+
+    Vector2_t<Float> pos{};
+    Vector2_t<Float> vel{};
+    Vector2_t<Float> acc{};
+    Float mass{1};
 
-    f64 a_pos{};
-    f64 a_vel{};
-    f64 a_acc{};
-    f64 a_mass{};
+    Float a_pos{};   // angle, counter-clockwise
+    Float a_vel{};   // angular velocity
+    Float a_acc{};   // angular acceleration
+    Float a_mass{1}; // moment of inertia about the centre of mass
 
-    constexpr auto apply_force(Vector2 force) noexcept { acc += force / mass; }
+    constexpr auto apply_force(Vector2_t<Float> force) noexcept { acc += force / mass; }
 
-    constexpr auto apply_torque(f64 torque) noexcept { a_acc += torque / a_mass; }
+    constexpr auto apply_torque(Float torque) noexcept { a_acc += torque / a_mass; }
 
-    constexpr auto apply_force(Vector2 force, Vector2 relative_pos) noexcept
+    /**
+     * @brief               Apply a force at a point, which also turns the body
+     *
+     * @param  force
+     * @param  relative_pos Point of application, relative to the centre of mass
+     */
+    constexpr auto apply_force(Vector2_t<Float> force, Vector2_t<Float> relative_pos) noexcept
     {
         acc += force / mass;
+        a_acc += Vector2_t<Float>::cross(relative_pos, force) / a_mass;
+    }
+
+    /**
+     * @brief               Change the momentum at once, at a point relative to the centre of mass
+     */
+    constexpr auto apply_impulse(Vector2_t<Float> impulse, Vector2_t<Float> relative_pos) noexcept
+    {
+        vel += impulse / mass;
+        a_vel += Vector2_t<Float>::cross(relative_pos, impulse) / a_mass;
+    }
+
+    /**
+     * @brief               Velocity of a point relative to the centre of mass
+     */
+    [[nodiscard]] constexpr auto velocity_at(Vector2_t<Float> relative_pos) const noexcept
+    {
+        return vel + Vector2_t<Float>{-a_vel * relative_pos.y, a_vel * relative_pos.x};
     }
 
-    constexpr auto update(f64 time_delta = 1.0 / 64) noexcept
+    constexpr auto update(Float time_delta = 1.0 / 64) noexcept
     {
         vel += acc * time_delta;
         pos += vel * time_delta;
-        acc = Vector2{}; // reset acceleration
+        acc = Vector2_t<Float>{}; // reset acceleration
 
         a_vel += a_acc * time_delta;
         a_pos += a_vel * time_delta;
-        a_acc = 0.0; // reset acceleration
+        a_acc = Float{}; // reset acceleration
     }
 
     [[nodiscard]] constexpr auto operator==(const RigidBody&) const -> bool = default;
@@ -0,0 +1,313 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <algorithm> // for clamp, sort, swap
+#include <array>     // for array
+#include <cmath>     // for cos, sin
+#include <span>      // for span
+#include <utility>   // for move
+#include <vector>    // for vector
+
+#include "samarium/core/types.hpp"         // for f64, u32, u64
+#include "samarium/math/Vector2.hpp"       // for Vector2_t
+#include "samarium/math/loop.hpp"          // for end
+#include "samarium/math/math.hpp"          // for min, max
+#include "samarium/util/SweepAndPrune.hpp" // for SweepAndPrune
+#include "samarium/util/util.hpp"          // for project_view
+
+#include "Collider.hpp"  // for Collider
+#include "RigidBody.hpp" // for RigidBody
+#include "collision.hpp" // for IndexPair
+#include "contact.hpp"   // for collide, Manifold, PlacedCollider
+
+namespace sm
+{
+/**
+ * @brief               Rigid bodies which collide with each other: circles and convex polygons,
+ * with friction. Contacts are found with a SweepAndPrune over the bounding circles of the bodies
+ * and separating axes, and resolved with sequential impulses, warm started from the impulses of
+ * the same contacts in the last step
+ *
+ * A body with infinite mass is static. Forces applied to the bodies between steps are used up by
+ * the next step
+ *
+ * @tparam Float        Floating point type
+ */
+template <typename Float = f64> struct RigidBodySystem
+{
+    using Vector_t = Vector2_t<Float>;
+
+    struct Contact
+    {
+        phys::ContactPoint<Float> point{};
+        Vector_t rel_a{};        // from the centre of the first body to the point
+        Vector_t rel_b{};        // from the centre of the second body to the point
+        Float normal_impulse{};  // summed over the iterations, and kept for the next step
+        Float tangent_impulse{}; // friction, summed the same way
+        Float normal_mass{};     // inverse of the response to an impulse along the normal
+        Float tangent_mass{};    // inverse of the response to an impulse along the surface
+        Float bias{};            // extra speed to push overlapping bodies apart
+    };
+
+    struct ContactManifold
+    {
+        phys::IndexPair bodies{}; // the first is the smaller index
+        Vector_t normal{};        // from the first body to the second
+        u32 count{};
+        std::array<Contact, 2> contacts{};
+    };
+
+    std::vector<RigidBody<Float>> bodies{};
+    std::vector<Collider<Float>> colliders{};
+    Vector_t gravity{};
+
+    Float friction{0.5};
+    u32 iterations{10};                              // of the impulse solver per step
+    bool warm_starting{true};                        // start from the impulses of the last step
+    Float bias_factor{static_cast<Float>(0.2)};      // fraction of the overlap removed each step
+    Float allowed_overlap{static_cast<Float>(0.01)}; // kept, so resting contacts persist
+
+    SweepAndPrune<u32> broadphase{};
+    std::vector<ContactManifold> manifolds{}; // sorted by bodies
+
+    /**
+     * @brief               Add a body with a shape, setting its moment of inertia from its mass
+     *
+     * @return u32          Index of the body
+     */
+    auto add(RigidBody<Float> body, Collider<Float> collider)
+    {
+        body.a_mass = collider.inertia(body.mass);
+        bodies.push_back(body);
+        colliders.push_back(std::move(collider));
+        return static_cast<u32>(bodies.size() - 1);
+    }
+
+    [[nodiscard]] auto size() const noexcept { return bodies.size(); }
+
+    /**
+     * @brief               Advance the bodies by `time_delta`
+     */
+    void step(Float time_delta)
+    {
+        integrate_velocities(time_delta);
+        place();
+        find_contacts();
+        prepare_contacts(time_delta);
+        for (auto iteration : loop::end(iterations))
+        {
+            static_cast<void>(iteration);
+            for (auto& manifold : manifolds) { solve(manifold); }
+        }
+
+        for (auto& body : bodies)
+        {
+            body.pos += body.vel * time_delta;
+            body.a_pos += body.a_vel * time_delta;
+        }
+    }
+
+    /**
+     * @brief               Rotate the polygons into the world, for placed(). step() does this
+     * before it finds contacts
+     */
+    void place()
+    {
+        world_vertices.clear();
+        world_normals.clear();
+        vertex_offsets.assign(1, 0UL);
+        for (auto i : loop::end(bodies.size()))
+        {
+            const auto& body     = bodies[i];
+            const auto& vertices = colliders[i].vertices;
+            const auto cos       = std::cos(body.a_pos);
+            const auto sin       = std::sin(body.a_pos);
+            const auto rotate    = [&](Vector_t vec)
+            { return Vector_t{cos * vec.x - sin * vec.y, sin * vec.x + cos * vec.y}; };
+
+            for (auto j : loop::end(vertices.size()))
+            {
+                const auto edge = vertices[(j + 1) % vertices.size()] - vertices[j];
+                world_vertices.push_back(body.pos + rotate(vertices[j]));
+                world_normals.push_back(rotate(Vector_t{edge.y, -edge.x}.normalized()));
+            }
+            vertex_offsets.push_back(world_vertices.size());
+        }
+    }
+
+    /**
+     * @brief               The shape of body i, as of the last place()
+     */
+    [[nodiscard]] auto placed(u64 index) const noexcept
+    {
+        const auto start = vertex_offsets[index];
+        const auto count = vertex_offsets[index + 1] - start;
+        return phys::PlacedCollider<Float>{
+            bodies[index].pos, colliders[index].radius,
+            std::span<const Vector_t>{world_vertices}.subspan(start, count),
+            std::span<const Vector_t>{world_normals}.subspan(start, count)};
+    }
+
+  private:
+    std::vector<Float> inverse_masses{};
+    std::vector<Float> inverse_inertias{};
+    std::vector<Vector_t> world_vertices{}; // of every polygon, one after the other
+    std::vector<Vector_t> world_normals{};
+    std::vector<u64> vertex_offsets{};
+    std::vector<ContactManifold> next_manifolds{};
+
+    void integrate_velocities(Float time_delta)
+    {
+        inverse_masses.resize(bodies.size());
+        inverse_inertias.resize(bodies.size());
+        for (auto i : loop::end(bodies.size()))
+        {
+            auto& body          = bodies[i];
+            inverse_masses[i]   = Float{1} / body.mass;
+            inverse_inertias[i] = Float{1} / body.a_mass;
+            if (inverse_masses[i] != Float{0}) { body.vel += (body.acc + gravity) * time_delta; }
+            body.a_vel += body.a_acc * time_delta;
+            body.acc   = Vector_t{};
+            body.a_acc = Float{};
+        }
+    }
+
+    void find_contacts()
+    {
+        broadphase.rebuild(bodies | util::project_view(&RigidBody<Float>::pos),
+                           colliders | util::project_view(&Collider<Float>::radius));
+
+        next_manifolds.clear();
+        broadphase.for_each_pair(
+            [&](u32 i, u32 j)
+            {
+                if (i > j) { std::swap(i, j); }
+                if (inverse_masses[i] == Float{0} && inverse_masses[j] == Float{0}) { return; }
+
+                const auto manifold = phys::collide(placed(i), placed(j));
+                if (manifold.count == 0) { return; }
+
+                auto& next  = next_manifolds.emplace_back();
+                next.bodies = {i, j};
+                next.normal = manifold.normal;
+                next.count  = manifold.count;
+                for (auto c : loop::end(manifold.count))
+                {
+                    next.contacts[c].point = manifold.points[c];
+                }
+            });
+
+        std::sort(next_manifolds.begin(), next_manifolds.end(),
+                  [](const ContactManifold& a, const ContactManifold& b)
+                  { return a.bodies < b.bodies; });
+
+        // carry the impulses of contacts which are still touching the same features
+        if (warm_starting)
+        {
+            auto old = manifolds.begin();
+            for (auto& next : next_manifolds)
+            {
+                while (old != manifolds.end() && old->bodies < next.bodies) { ++old; }
+                if (old == manifolds.end()) { break; }
+                if (old->bodies != next.bodies) { continue; }
+
+                for (auto& contact : std::span{next.contacts}.first(next.count))
+                {
+                    for (const auto& last : std::span{old->contacts}.first(old->count))
+                    {
+                        if (last.point.id != contact.point.id) { continue; }
+                        contact.normal_impulse  = last.normal_impulse;
+                        contact.tangent_impulse = last.tangent_impulse;
+                    }
+                }
+            }
+        }
+        manifolds.swap(next_manifolds);
+    }
+
+    void apply_impulse(const ContactManifold& manifold, const Contact& contact, Vector_t impulse)
+    {
+        const auto [i, j] = manifold.bodies;
+        auto& a           = bodies[i];
+        auto& b           = bodies[j];
+        a.vel -= impulse * inverse_masses[i];
+        a.a_vel -= Vector_t::cross(contact.rel_a, impulse) * inverse_inertias[i];
+        b.vel += impulse * inverse_masses[j];
+        b.a_vel += Vector_t::cross(contact.rel_b, impulse) * inverse_inertias[j];
+    }
+
+    void prepare_contacts(Float time_delta)
+    {
+        for (auto& manifold : manifolds)
+        {
+            const auto [i, j]  = manifold.bodies;
+            const auto normal  = manifold.normal;
+            const auto tangent = Vector_t{normal.y, -normal.x};
+            const auto masses  = inverse_masses[i] + inverse_masses[j];
+
+            for (auto& contact : std::span{manifold.contacts}.first(manifold.count))
+            {
+                contact.rel_a = contact.point.pos - bodies[i].pos;
+                contact.rel_b = contact.point.pos - bodies[j].pos;
+
+                const auto response = [&](Vector_t direction)
+                {
+                    const auto cross_a = Vector_t::cross(contact.rel_a, direction);
+                    const auto cross_b = Vector_t::cross(contact.rel_b, direction);
+                    return masses + inverse_inertias[i] * cross_a * cross_a +
+                           inverse_inertias[j] * cross_b * cross_b;
+                };
+                contact.normal_mass  = Float{1} / response(normal);
+                contact.tangent_mass = Float{1} / response(tangent);
+
+                const auto overlap = contact.point.separation + allowed_overlap;
+                contact.bias       = -bias_factor / time_delta * math::min(overlap, Float{0});
+
+                if (!warm_starting)
+                {
+                    contact.normal_impulse  = Float{};
+                    contact.tangent_impulse = Float{};
+                }
+                apply_impulse(manifold, contact,
+                              normal * contact.normal_impulse + tangent * contact.tangent_impulse);
+            }
+        }
+    }
+
+    void solve(ContactManifold& manifold)
+    {
+        const auto [i, j]  = manifold.bodies;
+        const auto normal  = manifold.normal;
+        const auto tangent = Vector_t{normal.y, -normal.x};
+
+        for (auto& contact : std::span{manifold.contacts}.first(manifold.count))
+        {
+            const auto relative_vel = [&]
+            {
+                return bodies[j].velocity_at(contact.rel_b) - bodies[i].velocity_at(contact.rel_a);
+            };
+
+            // the total normal impulse only pushes
+            const auto normal_vel  = Vector_t::dot(relative_vel(), normal);
+            const auto last_normal = contact.normal_impulse;
+            const auto push        = contact.normal_mass * (contact.bias - normal_vel);
+            contact.normal_impulse = math::max(last_normal + push, Float{0});
+            apply_impulse(manifold, contact, normal * (contact.normal_impulse - last_normal));
+
+            // and friction is limited by it
+            const auto max_friction = friction * contact.normal_impulse;
+            const auto tangent_vel  = Vector_t::dot(relative_vel(), tangent);
+            const auto last_tangent = contact.tangent_impulse;
+            contact.tangent_impulse = std::clamp(last_tangent - contact.tangent_mass * tangent_vel,
+                                                 -max_friction, max_friction);
+            apply_impulse(manifold, contact, tangent * (contact.tangent_impulse - last_tangent));
+        }
+    }
+};
+} // namespace sm
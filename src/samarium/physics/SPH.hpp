@@ -0,0 +1,249 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <span>   // for span
+#include <vector> // for vector
+
+#include "samarium/core/types.hpp"      // for f64, u32, u64
+#include "samarium/math/Vector2.hpp"    // for Vector2, Vector2_t
+#include "samarium/math/loop.hpp"       // for end, start_end
+#include "samarium/math/math.hpp"       // for max, pi
+#include "samarium/util/Error.hpp"      // for Error
+#include "samarium/util/ThreadPool.hpp" // for ThreadPool
+
+namespace sm
+{
+namespace sph
+{
+/**
+ * @brief               The 2D kernels of Müller et al. 2003: poly6 for density, the gradient of
+ * spiky for pressure and the Laplacian of the viscosity kernel for viscosity. Each is 0 at and
+ * beyond the smoothing length
+ *
+ * Another kernel can be used by SPH if it has the same 3 functions
+ */
+template <typename Float = f64> struct MullerKernels
+{
+    static constexpr auto pi = static_cast<Float>(math::pi);
+
+    Float smoothing_length;
+    Float h_sq;
+    Float poly6_scale;
+    Float spiky_scale;
+    Float viscosity_scale;
+
+    explicit MullerKernels(Float smoothing_length_)
+        : smoothing_length{smoothing_length_}, h_sq{smoothing_length * smoothing_length},
+          poly6_scale{Float{4} / (pi * math::power<8>(smoothing_length))},
+          spiky_scale{Float{-30} / (pi * math::power<5>(smoothing_length))},
+          viscosity_scale{Float{40} / (pi * math::power<5>(smoothing_length))}
+    {
+    }
+
+    /**
+     * @brief               Density contribution of a neighbour at squared distance `r_sq`
+     */
+    [[nodiscard]] auto density(Float r_sq) const noexcept
+    {
+        return poly6_scale * math::power<3>(h_sq - r_sq);
+    }
+
+    /**
+     * @brief               Gradient along the direction to the neighbour, at distance `r`
+     */
+    [[nodiscard]] auto pressure_gradient(Float r) const noexcept
+    {
+        return spiky_scale * math::power<2>(smoothing_length - r);
+    }
+
+    [[nodiscard]] auto viscosity_laplacian(Float r) const noexcept
+    {
+        return viscosity_scale * (smoothing_length - r);
+    }
+};
+} // namespace sph
+
+/**
+ * @brief               Smoothed particle hydrodynamics: turns the particles of a ParticleSystem
+ * into a fluid by adding pressure and viscosity forces
+ *
+ * Neighbours within the smoothing length are found once per step with the spatial index of the
+ * ParticleSystem and kept in a flat list, which both the density and the force passes read. Each
+ * pass only writes to its own particle, so it runs in parallel without locks
+ *
+ * @tparam Float        Floating point type of the particles
+ * @tparam Kernels      Smoothing kernels, such as sph::MullerKernels
+ */
+template <typename Float = f64, typename Kernels = sph::MullerKernels<Float>> struct SPH
+{
+    Kernels kernels;
+    Float rest_density{1};
+    Float stiffness{20};                      // pressure per unit of density above the rest
+    Float viscosity{static_cast<Float>(0.1)}; // dynamic viscosity
+
+    std::vector<u32> neighbor_offsets{}; // neighbours of particle i start at neighbor_offsets[i]
+    std::vector<u32> neighbors{};        // within the smoothing length, not including itself
+    std::vector<Float> densities{};
+    std::vector<Float> pressures{};
+
+    /**
+     * @param  smoothing_length At most the spacing of the grid of the particles, else
+     * apply_forces() throws sm::Error
+     */
+    explicit SPH(Float smoothing_length) : kernels{smoothing_length} {}
+
+    /**
+     * @brief               Add the acceleration from pressure and viscosity to each particle.
+     * Rebuilds the spatial index of `system`, which must not have sleeping enabled nor a spacing
+     * less than the smoothing length, else it throws sm::Error. Use it as (part of) the
+     * `apply_forces` of ParticleSystem::step()
+     *
+     * @param  system       A ParticleSystem
+     */
+    template <typename ParticleSystem_t> void apply_forces(ParticleSystem_t& system)
+    {
+        prepare(system);
+        const auto count = system.particles.size();
+        count_neighbors(system, 0UL, count);
+        sum_offsets();
+        fill_neighbors(system, 0UL, count);
+        compute_densities(system.particles, 0UL, count);
+        accelerate(system.particles, 0UL, count);
+    }
+
+    /**
+     * @brief               Add the acceleration from pressure and viscosity to each particle,
+     * using multiple threads
+     */
+    template <typename ParticleSystem_t>
+    void apply_forces(ParticleSystem_t& system, ThreadPool& thread_pool)
+    {
+        prepare(system);
+        const auto parallel = [&](auto&& job)
+        { thread_pool.parallel_for(0UL, system.particles.size(), job); };
+
+        parallel([&](u64 min, u64 max) { count_neighbors(system, min, max); });
+        sum_offsets();
+        parallel([&](u64 min, u64 max) { fill_neighbors(system, min, max); });
+        parallel([&](u64 min, u64 max) { compute_densities(system.particles, min, max); });
+        parallel([&](u64 min, u64 max) { accelerate(system.particles, min, max); });
+    }
+
+    /**
+     * @brief               Neighbours of particle i, as of the last apply_forces()
+     */
+    [[nodiscard]] auto neighbors_of(u64 index) const noexcept
+    {
+        return std::span<const u32>{neighbors}.subspan(
+            neighbor_offsets[index], neighbor_offsets[index + 1] - neighbor_offsets[index]);
+    }
+
+  private:
+    template <typename ParticleSystem_t> void prepare(ParticleSystem_t& system)
+    {
+        // with sleeping, the grid holds positions in the list of awake particles, not indices
+        if (system.activity.enabled())
+        {
+            throw Error{"SPH: the particle system must not have sleeping enabled"};
+        }
+        // neighbours are only looked for in the adjacent cells
+        if (static_cast<f64>(kernels.smoothing_length) > system.hash_grid.spacing)
+        {
+            throw Error{"SPH: the smoothing length is larger than the grid spacing"};
+        }
+        system.rebuild_hash_grid();
+        const auto count = system.particles.size();
+        neighbor_offsets.assign(count + 1, 0U);
+        densities.resize(count);
+        pressures.resize(count);
+    }
+
+    // call `callable(j)` for each particle j within the smoothing length of particle i
+    void for_each_candidate(const auto& system, u64 i, auto&& callable) const
+    {
+        const auto& particles = system.particles;
+        const auto pos        = particles[i].pos;
+        const auto candidate  = [&](u32 j)
+        {
+            if (j != i && (particles[j].pos - pos).length_sq() < kernels.h_sq) { callable(j); }
+        };
+        system.hash_grid.for_each_neighbor(static_cast<Vector2>(pos), candidate);
+    }
+
+    // neighbor_offsets[i + 1] = the number of neighbours of particle i, for sum_offsets()
+    void count_neighbors(const auto& system, u64 min, u64 max)
+    {
+        for (auto i : loop::start_end(min, max))
+        {
+            auto count = u32{};
+            for_each_candidate(system, i, [&](u32 /* j */) { count++; });
+            neighbor_offsets[i + 1] = count;
+        }
+    }
+
+    void sum_offsets()
+    {
+        for (auto i : loop::start_end(1UL, neighbor_offsets.size()))
+        {
+            neighbor_offsets[i] += neighbor_offsets[i - 1];
+        }
+        neighbors.resize(neighbor_offsets.back());
+    }
+
+    void fill_neighbors(const auto& system, u64 min, u64 max)
+    {
+        for (auto i : loop::start_end(min, max))
+        {
+            auto next = neighbor_offsets[i];
+            for_each_candidate(system, i, [&](u32 j) { neighbors[next++] = j; });
+        }
+    }
+
+    void compute_densities(const auto& particles, u64 min, u64 max)
+    {
+        const auto self = kernels.density(Float{0});
+        for (auto i : loop::start_end(min, max))
+        {
+            auto density = particles[i].mass * self;
+            for (auto j : neighbors_of(i))
+            {
+                density += particles[j].mass *
+                           kernels.density((particles[j].pos - particles[i].pos).length_sq());
+            }
+            densities[i] = density;
+
+            // no pressure below the rest density, which would pull particles together
+            pressures[i] = stiffness * math::max(density - rest_density, Float{0});
+        }
+    }
+
+    void accelerate(auto& particles, u64 min, u64 max) const
+    {
+        for (auto i : loop::start_end(min, max))
+        {
+            auto& particle = particles[i];
+            auto force     = Vector2_t<Float>{};
+            for (auto j : neighbors_of(i))
+            {
+                const auto& other = particles[j];
+                const auto vec    = other.pos - particle.pos;
+                const auto r      = vec.length();
+                if (r == Float{0}) { continue; }
+
+                // symmetric pressure, so each pair pushes apart equally
+                const auto pressure = (pressures[i] + pressures[j]) / (Float{2} * densities[j]);
+                force += vec * (other.mass * pressure * kernels.pressure_gradient(r) / r);
+                force += (other.vel - particle.vel) *
+                         (viscosity * other.mass * kernels.viscosity_laplacian(r) / densities[j]);
+            }
+            particle.acc += force / densities[i];
+        }
+    }
+};
+} // namespace sm
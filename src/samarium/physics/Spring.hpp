@@ -7,9 +7,8 @@
 
 #pragma once
 
-#include "samarium/core/types.hpp"       // for f64
-#include "samarium/math/Vector2.hpp"     // for Vector2_t, operator-, Vector2
-#include "samarium/math/vector_math.hpp" // for distance
+#include "samarium/core/types.hpp"   // for f64
+#include "samarium/math/Vector2.hpp" // for Vector2_t, operator-
 
 #include "Particle.hpp" // for Particle
 
@@ -19,26 +18,26 @@ template <typename Float = f64> struct Spring
 {
     Particle<Float>& p1;
     Particle<Float>& p2;
-    const f64 rest_length;
-    const f64 stiffness;
-    const f64 damping;
+    const Float rest_length;
+    const Float stiffness;
+    const Float damping;
 
     Spring(Particle<Float>& particle1,
            Particle<Float>& particle2,
-           f64 stiffness_ = 100.0,
-           f64 damping_   = 10.0) noexcept
-        : p1{particle1}, p2{particle2}, rest_length{math::distance(particle1.pos, particle2.pos)},
+           Float stiffness_ = 100.0,
+           Float damping_   = 10.0) noexcept
+        : p1{particle1}, p2{particle2}, rest_length{(particle2.pos - particle1.pos).length()},
           stiffness{stiffness_}, damping{damping_}
     {
     }
 
-    [[nodiscard]] auto length() const noexcept { return math::distance(p1.pos, p2.pos); }
+    [[nodiscard]] auto length() const noexcept { return (p2.pos - p1.pos).length(); }
 
     void update() noexcept
     {
         const auto vec    = p2.pos - p1.pos;
         const auto spring = (vec.length() - rest_length) * stiffness;
-        auto damp         = Vector2::dot(vec.normalized(), p2.vel - p1.vel) * damping;
+        auto damp         = Vector2_t<Float>::dot(vec.normalized(), p2.vel - p1.vel) * damping;
 
         const auto force = vec.with_length(spring + damp);
 
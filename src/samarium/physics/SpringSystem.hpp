@@ -0,0 +1,202 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <bit>    // for countr_one
+#include <span>   // for span
+#include <vector> // for vector
+
+#include "samarium/core/types.hpp"      // for f64, u32, u64
+#include "samarium/math/Vector2.hpp"    // for Vector2_t
+#include "samarium/math/loop.hpp"       // for end, start_end
+#include "samarium/math/math.hpp"       // for max
+#include "samarium/util/ThreadPool.hpp" // for ThreadPool
+
+#include "Particle.hpp"  // for Particle
+#include "collision.hpp" // for IndexPair
+
+namespace sm
+{
+/**
+ * @brief               Springs between particles of a ParticleSystem, referred to by index and
+ * stored as arrays, so particles can be moved or reordered and all springs are updated in one pass
+ *
+ * @tparam Float        Floating point type of the particles
+ */
+template <typename Float = f64> struct SpringSystem
+{
+    std::vector<phys::IndexPair> indices{}; // the 2 particles of each spring
+    std::vector<Float> rest_lengths{};
+    std::vector<Float> stiffnesses{};
+    std::vector<Float> dampings{};
+
+    /**
+     * @brief               Springs are grouped by colour: no 2 springs of a colour share a
+     * particle, so each colour can be updated in parallel. Colour c is the range
+     * [color_offsets[c], color_offsets[c + 1]). Empty until color() is called
+     */
+    std::vector<u32> color_offsets{};
+
+    /**
+     * @brief               Add a spring between 2 particles, at rest at their current distance
+     */
+    void add(std::span<const Particle<Float>> particles,
+             u32 i,
+             u32 j,
+             Float stiffness = Float{100},
+             Float damping   = Float{10})
+    {
+        add(i, j, (particles[j].pos - particles[i].pos).length(), stiffness, damping);
+    }
+
+    void add(u32 i, u32 j, Float rest_length, Float stiffness, Float damping)
+    {
+        indices.push_back({i, j});
+        rest_lengths.push_back(rest_length);
+        stiffnesses.push_back(stiffness);
+        dampings.push_back(damping);
+        color_offsets.clear();
+    }
+
+    [[nodiscard]] auto size() const noexcept { return indices.size(); }
+
+    [[nodiscard]] auto empty() const noexcept { return indices.empty(); }
+
+    [[nodiscard]] auto colored() const noexcept { return !color_offsets.empty() || empty(); }
+
+    /**
+     * @brief               Apply the force of every spring to its particles, the same as
+     * Spring::update() for each
+     */
+    void apply_forces(std::span<Particle<Float>> particles) const noexcept
+    {
+        apply_range(particles, 0UL, size());
+    }
+
+    /**
+     * @brief               Apply the force of every spring using multiple threads. Colours are
+     * updated one after the other and springs of a colour in parallel, so no 2 threads write to the
+     * same particle
+     */
+    void apply_forces(std::span<Particle<Float>> particles, ThreadPool& thread_pool)
+    {
+        if (empty()) { return; }
+        if (!colored()) { color(); }
+
+        for (auto c : loop::end(color_offsets.size() - 1))
+        {
+            const auto job = [&](auto min, auto max) { apply_range(particles, min, max); };
+            thread_pool.parallel_for(static_cast<u64>(color_offsets[c]),
+                                     static_cast<u64>(color_offsets[c + 1]), job);
+        }
+    }
+
+    /**
+     * @brief               Sort the springs by colour, with a greedy edge colouring: each spring
+     * takes the first colour neither of its particles has. A cloth needs about 2x the most springs
+     * at one particle
+     */
+    void color()
+    {
+        // 64 colours at most, tracked as a bitmask per particle. The last takes the rest
+        auto max_index = u32{};
+        for (const auto& [i, j] : indices) { max_index = math::max(max_index, math::max(i, j)); }
+        auto used   = std::vector<u64>(empty() ? 0UL : max_index + 1UL);
+        auto colors = std::vector<u32>(size());
+
+        auto color_count = 1U;
+        for (auto s : loop::end(size()))
+        {
+            const auto [i, j] = indices[s];
+            const auto taken  = used[i] | used[j];
+            auto c            = static_cast<u32>(std::countr_one(taken));
+            if (c >= 63U) { c = 63U; }
+            else
+            {
+                used[i] |= u64{1} << c;
+                used[j] |= u64{1} << c;
+            }
+            colors[s]   = c;
+            color_count = math::max(color_count, c + 1U);
+        }
+
+        // stable counting sort of the springs by colour
+        color_offsets.assign(color_count + 1UL, 0U);
+        for (auto c : colors) { color_offsets[c + 1]++; }
+        for (auto c : loop::end(static_cast<u64>(color_count)))
+        {
+            color_offsets[c + 1] += color_offsets[c];
+        }
+
+        auto next  = std::vector<u32>(color_offsets.begin(), color_offsets.end() - 1);
+        auto order = std::vector<u32>(size());
+        for (auto s : loop::end(size())) { order[next[colors[s]]++] = static_cast<u32>(s); }
+
+        permute_springs(order);
+
+        // springs in the last colour may share particles, so update them serially
+        if (color_count == 64U) { split_last_color(); }
+    }
+
+    /**
+     * @brief               Follow the particles after ParticleSystem::reorder()
+     *
+     * @param  new_index    New index of each particle
+     */
+    void reorder(std::span<const u32> new_index)
+    {
+        for (auto& [i, j] : indices)
+        {
+            i = new_index[i];
+            j = new_index[j];
+        }
+    }
+
+  private:
+    void apply_range(std::span<Particle<Float>> particles, u64 min, u64 max) const noexcept
+    {
+        for (auto s : loop::start_end(min, max))
+        {
+            auto& p1 = particles[indices[s][0]];
+            auto& p2 = particles[indices[s][1]];
+
+            const auto vec      = p2.pos - p1.pos;
+            const auto spring   = (vec.length() - rest_lengths[s]) * stiffnesses[s];
+            const auto relative = Vector2_t<Float>::dot(vec.normalized(), p2.vel - p1.vel);
+            const auto force    = vec.with_length(spring + relative * dampings[s]);
+
+            p1.apply_force(force);
+            p2.apply_force(-force);
+        }
+    }
+
+    template <typename T> static void gather(std::vector<T>& values, std::span<const u32> order)
+    {
+        auto output = std::vector<T>(values.size());
+        for (auto i : loop::end(values.size())) { output[i] = values[order[i]]; }
+        values.swap(output);
+    }
+
+    void permute_springs(std::span<const u32> order)
+    {
+        gather(indices, order);
+        gather(rest_lengths, order);
+        gather(stiffnesses, order);
+        gather(dampings, order);
+    }
+
+    // one range per spring, which keeps apply_forces() simple at the cost of a barrier each
+    void split_last_color()
+    {
+        const auto start = color_offsets[color_offsets.size() - 2];
+        const auto end   = color_offsets.back();
+        color_offsets.pop_back();
+        for (auto s : loop::start_end(start + 1U, end + 1U)) { color_offsets.push_back(s); }
+    }
+};
+} // namespace sm
@@ -0,0 +1,144 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <utility> // for pair
+#include <vector>  // for vector
+
+#include "samarium/core/types.hpp"       // for f64, u32, u64
+#include "samarium/math/Vector2.hpp"     // for Vector2_t
+#include "samarium/math/loop.hpp"        // for end, start_end
+#include "samarium/util/UniformGrid.hpp" // for UniformGrid
+
+namespace sm
+{
+/**
+ * @brief               Verlet neighbour list: every pair of particles closer than the cutoff plus
+ * a skin, cached between steps. It is rebuilt only once some particle has moved more than half
+ * the skin since the last build, as until then no pair can have come within the cutoff unseen
+ *
+ * Pairs are stored half-shell in a flat list: the neighbours of particle i, all with larger
+ * indices, start at offsets[i]. Use it with ParticleSystem::self_collision() and
+ * phys::for_each_pair_within() instead of rebuilding the spatial index every step, for dense
+ * systems which move little per step
+ *
+ * @tparam Float        Floating point type of the particles
+ */
+template <typename Float = f64> struct VerletList
+{
+    using Vector_t = Vector2_t<Float>;
+
+    Float cutoff; // largest distance at which particles interact
+    Float skin;   // extra distance kept in the list, which sets how often it is rebuilt
+
+    std::vector<u32> offsets{};   // neighbours of particle i start at offsets[i]
+    std::vector<u32> neighbors{}; // each larger than the particle whose neighbour it is
+    u64 rebuild_count{};          // rebuilds so far
+    u64 update_count{};           // calls to update() so far
+
+    /**
+     * @param  cutoff_      For collisions, the largest sum of the radii of 2 particles
+     * @param  skin_        A fraction of the cutoff, such as 0.3: larger means fewer rebuilds but
+     * more pairs to check
+     */
+    VerletList(Float cutoff_, Float skin_) : cutoff{cutoff_}, skin{skin_} {}
+
+    /**
+     * @brief               Rebuild the list if some particle has moved more than half the skin,
+     * or the number of particles has changed
+     *
+     * @param  particles    Sized range of particles
+     * @return bool         Whether it was rebuilt
+     */
+    auto update(const auto& particles) -> bool
+    {
+        update_count++;
+        if (!needs_rebuild(particles)) { return false; }
+        rebuild(particles);
+        return true;
+    }
+
+    /**
+     * @brief               Rebuild the list from the positions of `particles`
+     */
+    void rebuild(const auto& particles)
+    {
+        rebuild_count++;
+        const auto count = static_cast<u64>(particles.size());
+        reference.resize(count);
+        for (auto i : loop::end(count)) { reference[i] = particles[i].pos; }
+
+        const auto range    = cutoff + skin;
+        const auto range_sq = range * range;
+        grid.spacing        = static_cast<f64>(range);
+        grid.rebuild(reference);
+
+        pairs.clear();
+        grid.for_each_pair(
+            [&](u32 i, u32 j)
+            {
+                if ((reference[j] - reference[i]).length_sq() >= range_sq) { return; }
+                pairs.push_back(i < j ? std::pair{i, j} : std::pair{j, i});
+            });
+
+        // counting sort of the pairs by their first particle
+        offsets.assign(count + 1, 0U);
+        for (const auto& pair : pairs) { offsets[pair.first + 1]++; }
+        for (auto i : loop::start_end(1UL, count + 1)) { offsets[i] += offsets[i - 1]; }
+
+        neighbors.resize(pairs.size());
+        next.assign(offsets.begin(), offsets.end() - 1);
+        for (const auto& [i, j] : pairs) { neighbors[next[i]++] = j; }
+    }
+
+    /**
+     * @brief               Call `callable(p1, p2)` once for every pair in the list, as of the last
+     * update(). Pairs may be up to the cutoff plus the skin apart
+     *
+     * @param  particles    As passed to update()
+     * @param  callable     Takes 2 particles
+     */
+    void for_each_pair(auto& particles, auto&& callable) const
+    {
+        if (offsets.empty()) { return; }
+        for (auto i : loop::end(offsets.size() - 1))
+        {
+            for (auto k : loop::start_end(offsets[i], offsets[i + 1]))
+            {
+                callable(particles[i], particles[neighbors[k]]);
+            }
+        }
+    }
+
+    /**
+     * @return u64          Number of pairs in the list
+     */
+    [[nodiscard]] auto size() const noexcept { return neighbors.size(); }
+
+  private:
+    std::vector<Vector_t> reference{}; // positions at the last rebuild
+    std::vector<std::pair<u32, u32>> pairs{};
+    std::vector<u32> next{};
+    UniformGrid<u32> grid{};
+
+    [[nodiscard]] auto needs_rebuild(const auto& particles) const
+    {
+        if (static_cast<u64>(particles.size()) != reference.size() || offsets.empty())
+        {
+            return true;
+        }
+
+        const auto limit_sq = skin * skin / Float{4};
+        for (auto i : loop::end(reference.size()))
+        {
+            if ((particles[i].pos - reference[i]).length_sq() > limit_sq) { return true; }
+        }
+        return false;
+    }
+};
+} // namespace sm
@@ -0,0 +1,132 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <span>   // for span
+#include <vector> // for vector
+
+#include "samarium/core/types.hpp"   // for f64, u32, u64
+#include "samarium/math/Vector2.hpp" // for Vector2_t
+#include "samarium/math/loop.hpp"    // for end
+#include "samarium/math/math.hpp"    // for max, abs
+
+#include "Particle.hpp"     // for Particle
+#include "SpringSystem.hpp" // for SpringSystem
+
+namespace sm::phys
+{
+/**
+ * @brief               Extended position based dynamics (XPBD) solver for the distance
+ * constraints of a SpringSystem. Each spring is a constraint with compliance 1 / stiffness, solved
+ * by moving positions, so stiffness is not limited by the time step
+ *
+ * Use it as the `project_constraints` of ParticleSystem::step() with phys::PositionVerlet, which
+ * derives velocities from the corrected positions. Spring damping is not used: the solver loses
+ * energy by itself, more so with fewer iterations
+ *
+ * Warm starting begins each step from a fraction of the last step's multipliers, so fewer
+ * iterations reach the same error. About 0.5 is safe: close to 1 with very few iterations, errors
+ * left over from one step grow in the next
+ *
+ * @tparam Float        Floating point type of the particles
+ */
+template <typename Float = f64> struct XPBD
+{
+    u32 iterations{10};           // Gauss-Seidel sweeps over the constraints per step
+    Float warm_start{0};          // fraction of the last multipliers to start from, or 0
+    std::vector<Float> lambdas{}; // Lagrange multiplier of each constraint, from the last step
+
+    /**
+     * @brief               Move the particles to satisfy the springs
+     *
+     * @param  particles
+     * @param  springs
+     * @param  time_delta   Time step, which scales the compliance
+     */
+    void solve(std::span<Particle<Float>> particles,
+               const SpringSystem<Float>& springs,
+               Float time_delta)
+    {
+        const auto count = springs.size();
+        if (lambdas.size() != count) { lambdas.assign(count, Float{0}); }
+
+        const auto dt_sq = time_delta * time_delta;
+        if (warm_start > Float{0})
+        {
+            for (auto s : loop::end(count))
+            {
+                lambdas[s] *= warm_start;
+                correct(particles, springs, s, lambdas[s]);
+            }
+        }
+        else { lambdas.assign(count, Float{0}); }
+
+        for (auto iteration : loop::end(iterations))
+        {
+            static_cast<void>(iteration);
+            for (auto s : loop::end(count))
+            {
+                const auto& [i, j] = springs.indices[s];
+                auto& p1           = particles[i];
+                auto& p2           = particles[j];
+
+                const auto w1  = Float{1} / p1.mass;
+                const auto w2  = Float{1} / p2.mass;
+                const auto vec = p2.pos - p1.pos;
+                const auto len = vec.length();
+                if (w1 + w2 == Float{0} || len == Float{0}) { continue; }
+
+                const auto alpha = Float{1} / (springs.stiffnesses[s] * dt_sq);
+                const auto error = len - springs.rest_lengths[s];
+                const auto delta = (error - alpha * lambdas[s]) / (w1 + w2 + alpha);
+                lambdas[s] += delta;
+
+                const auto correction = vec * (delta / len);
+                p1.pos += correction * w1;
+                p2.pos -= correction * w2;
+            }
+        }
+    }
+
+    /**
+     * @brief               Largest |length - rest length| / rest length over the springs
+     */
+    [[nodiscard]] static auto max_strain(std::span<const Particle<Float>> particles,
+                                         const SpringSystem<Float>& springs)
+    {
+        auto max = Float{0};
+        for (auto s : loop::end(springs.size()))
+        {
+            const auto& [i, j] = springs.indices[s];
+            const auto rest    = springs.rest_lengths[s];
+            const auto strain  = (particles[j].pos - particles[i].pos).length() - rest;
+            max                = math::max(max, math::abs(strain) / rest);
+        }
+        return max;
+    }
+
+  private:
+    // move the particles of spring s as if by multiplier lambda
+    static void correct(std::span<Particle<Float>> particles,
+                        const SpringSystem<Float>& springs,
+                        u64 s,
+                        Float lambda)
+    {
+        const auto& [i, j] = springs.indices[s];
+        auto& p1           = particles[i];
+        auto& p2           = particles[j];
+        const auto vec     = p2.pos - p1.pos;
+        const auto len     = vec.length();
+        if (len == Float{0}) { return; }
+
+        const auto correction = vec * (lambda / len);
+        p1.pos += correction / p1.mass;
+        p2.pos -= correction / p2.mass;
+    }
+};
+} // namespace sm::phys
@@ -7,10 +7,22 @@
 
 #pragma once
 
-#include <optional> // for optional, nullopt
+#include <array>       // for array
+#include <bit>         // for popcount
+#include <cmath>       // for sqrt
+#include <optional>    // for optional, nullopt
+#include <span>        // for span
+#include <type_traits> // for is_same_v, remove_cvref_t
 
-#include "samarium/core/types.hpp"       // for f64
+#if defined(__AVX2__)
+#include <immintrin.h> // for _mm256_*
+#endif
+
+#include "samarium/core/types.hpp"       // for f64, u32, u64
+#include "samarium/geometry/BVH.hpp"     // for BVH
+#include "samarium/math/BoundingBox.hpp" // for BoundingBox
 #include "samarium/math/Vector2.hpp"     // for Vector2_t, operator+, opera...
+#include "samarium/math/loop.hpp"        // for end, start_end
 #include "samarium/math/shapes.hpp"      // for LineSegment
 #include "samarium/math/vector_math.hpp" // for distance, clamped_intersection
 
@@ -21,9 +33,12 @@ namespace sm::phys
 template <typename Float = f64>
 [[nodiscard]] auto did_collide(const Particle<Float>& p1, const Particle<Float>& p2) -> bool
 {
-    return math::distance(p1.pos, p2.pos) < p1.radius + p2.radius;
+    const auto radius_sum = p1.radius + p2.radius;
+    return (p2.pos - p1.pos).length_sq() < radius_sum * radius_sum;
 }
 
+using IndexPair = std::array<u32, 2>;
+
 namespace detail
 {
 [[nodiscard]] constexpr auto
@@ -33,65 +48,397 @@ solve_collision(f64& vel_left, f64& vel_right, f64 mass_left, f64 mass_right, f6
     vel_left  = (mass_left * vel_left + mass_right * vel_right - delta) / (mass_left + mass_right);
     vel_right = vel_left + delta;
 }
+
+#if defined(__AVX2__)
+/**
+ * @brief               Collide 4 consecutive pairs in the lanes of AVX2 registers
+ *
+ * If 2 overlapping pairs share a particle, the result would depend on their order, so the group
+ * falls back to colliding one pair at a time
+ *
+ * @return u64          Number of collisions
+ */
+inline auto collide_4(std::span<Particle<f64>> particles, const IndexPair* pairs, f64 damping)
+    -> u64;
+#endif
 } // namespace detail
 
+/**
+ * @brief               Collide 2 particles with an impulse along the line joining their centres
+ *
+ * Only the component of the velocities along the normal changes, so nothing needs to be rotated:
+ * the whole update is a few dot products. Coincident particles have no normal and are left alone
+ *
+ * @param  p1
+ * @param  p2
+ * @param  damping      Coefficient of restitution
+ * @return true         If the particles overlapped and were approaching each other
+ */
 template <typename Float = f64>
 [[maybe_unused]] auto collide(Particle<Float>& p1, Particle<Float>& p2, f64 damping = 1.0) -> bool
 {
     // https://strangequark1041.github.io/samarium/physics/two-Particle<Float>-collision
-    if (!did_collide(p1, p2)) { return false; }
+    const auto normal     = p2.pos - p1.pos;
+    const auto dist_sq    = normal.length_sq();
+    const auto radius_sum = p1.radius + p2.radius;
+    const auto approach   = Vector2_t<Float>::dot(p2.vel - p1.vel, normal);
+
+    if (!(dist_sq < radius_sum * radius_sum && dist_sq > Float{0} && approach <= Float{0}))
+    {
+        return false;
+    }
+
+    // detail::solve_collision applied to the normal components, divided by |normal| twice: once to
+    // get the components and once to turn the change back into a vector
+    const auto damping_   = static_cast<Float>(damping);
+    const auto total_mass = p1.mass + p2.mass;
+    const auto scale      = approach / (dist_sq * total_mass);
+    const auto impulse1   = scale * (p2.mass + damping_);
+    const auto impulse2   = scale * (p1.mass - damping_ + damping_ * total_mass);
+    p1.vel += normal * impulse1;
+    p2.vel -= normal * impulse2;
+    return true;
+}
+
+/**
+ * @brief               Collide many candidate pairs of particles, in order
+ *
+ * Gives the same result as calling collide() on each pair in turn. With AVX2, groups of 4 pairs
+ * are tested and resolved together
+ *
+ * @param  particles
+ * @param  pairs        Indices into particles
+ * @param  damping      Coefficient of restitution
+ * @return u64          Number of collisions
+ */
+template <typename Float = f64>
+[[maybe_unused]] auto
+collide(std::span<Particle<Float>> particles, std::span<const IndexPair> pairs, f64 damping = 1.0)
+    -> u64
+{
+    auto count = u64{};
+    auto i     = u64{};
+
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<Float, f64>)
+    {
+        for (; i + 4 <= pairs.size(); i += 4)
+        {
+            count += detail::collide_4(particles, pairs.data() + i, damping);
+        }
+    }
+#endif
+
+    for (; i < pairs.size(); i++)
+    {
+        count += collide(particles[pairs[i][0]], particles[pairs[i][1]], damping);
+    }
+    return count;
+}
 
-    const auto angle_of_impact = Vector2::angle_between(p1.pos, p2.pos);
+#if defined(__AVX2__)
+namespace detail
+{
+inline auto collide_4(std::span<Particle<f64>> particles, const IndexPair* pairs, f64 damping)
+    -> u64
+{
+    const auto gather = [&](u64 side, auto&& get)
+    {
+        return _mm256_set_pd(get(particles[pairs[3][side]]), get(particles[pairs[2][side]]),
+                             get(particles[pairs[1][side]]), get(particles[pairs[0][side]]));
+    };
+    const auto pos_x  = [](const Particle<f64>& p) { return p.pos.x; };
+    const auto pos_y  = [](const Particle<f64>& p) { return p.pos.y; };
+    const auto vel_x  = [](const Particle<f64>& p) { return p.vel.x; };
+    const auto vel_y  = [](const Particle<f64>& p) { return p.vel.y; };
+    const auto radius = [](const Particle<f64>& p) { return p.radius; };
+    const auto mass   = [](const Particle<f64>& p) { return p.mass; };
+
+    const auto zero       = _mm256_setzero_pd();
+    const auto normal_x   = _mm256_sub_pd(gather(1, pos_x), gather(0, pos_x));
+    const auto normal_y   = _mm256_sub_pd(gather(1, pos_y), gather(0, pos_y));
+    const auto dist_sq    = _mm256_add_pd(_mm256_mul_pd(normal_x, normal_x),
+                                          _mm256_mul_pd(normal_y, normal_y));
+    const auto radius_sum = _mm256_add_pd(gather(0, radius), gather(1, radius));
+    const auto overlap =
+        _mm256_and_pd(_mm256_cmp_pd(dist_sq, _mm256_mul_pd(radius_sum, radius_sum), _CMP_LT_OQ),
+                      _mm256_cmp_pd(dist_sq, zero, _CMP_GT_OQ));
 
-    // ensure p1 is on the left
-    const auto swap_left_right =
-        p1.pos.rotated(-angle_of_impact).x > p2.pos.rotated(-angle_of_impact).x;
+    const auto overlap_bits = static_cast<u32>(_mm256_movemask_pd(overlap));
+    if (overlap_bits == 0U) { return 0; }
 
-    p1.vel.rotate(-angle_of_impact);
-    p2.vel.rotate(-angle_of_impact);
+    // overlapping pairs sharing a particle must be resolved in order
+    for (auto a : loop::end(4U))
+    {
+        for (auto b : loop::start_end(a + 1, 4U))
+        {
+            if (((overlap_bits >> a) & (overlap_bits >> b) & 1U) == 0U) { continue; }
+            if (pairs[a][0] == pairs[b][0] || pairs[a][0] == pairs[b][1] ||
+                pairs[a][1] == pairs[b][0] || pairs[a][1] == pairs[b][1])
+            {
+                auto count = u64{};
+                for (auto i : loop::end(4U))
+                {
+                    count += collide(particles[pairs[i][0]], particles[pairs[i][1]], damping);
+                }
+                return count;
+            }
+        }
+    }
 
-    if (swap_left_right) { std::swap(p1, p2); }
+    const auto vel1_x   = gather(0, vel_x);
+    const auto vel1_y   = gather(0, vel_y);
+    const auto vel2_x   = gather(1, vel_x);
+    const auto vel2_y   = gather(1, vel_y);
+    const auto approach = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(vel2_x, vel1_x), normal_x),
+                                        _mm256_mul_pd(_mm256_sub_pd(vel2_y, vel1_y), normal_y));
+    const auto collided = _mm256_and_pd(overlap, _mm256_cmp_pd(approach, zero, _CMP_LE_OQ));
+    const auto bits     = static_cast<u32>(_mm256_movemask_pd(collided));
+    if (bits == 0U) { return 0; }
 
-    const auto did_collide = p2.vel.x <= p1.vel.x;
-    if (did_collide) { detail::solve_collision(p1.vel.x, p2.vel.x, p1.mass, p2.mass, damping); }
+    const auto mass1      = gather(0, mass);
+    const auto mass2      = gather(1, mass);
+    const auto damping_   = _mm256_set1_pd(damping);
+    const auto total_mass = _mm256_add_pd(mass1, mass2);
+    const auto scale =
+        _mm256_and_pd(collided, _mm256_div_pd(approach, _mm256_mul_pd(dist_sq, total_mass)));
+    const auto impulse1 = _mm256_mul_pd(scale, _mm256_add_pd(mass2, damping_));
+    const auto impulse2 = _mm256_mul_pd(
+        scale, _mm256_add_pd(_mm256_sub_pd(mass1, damping_), _mm256_mul_pd(damping_, total_mass)));
 
-    // cleanup:
-    if (swap_left_right) { std::swap(p1, p2); }
-    p1.vel.rotate(angle_of_impact);
-    p2.vel.rotate(angle_of_impact);
+    auto out = std::array<std::array<f64, 4>, 4>{};
+    _mm256_storeu_pd(out[0].data(), _mm256_add_pd(vel1_x, _mm256_mul_pd(normal_x, impulse1)));
+    _mm256_storeu_pd(out[1].data(), _mm256_add_pd(vel1_y, _mm256_mul_pd(normal_y, impulse1)));
+    _mm256_storeu_pd(out[2].data(), _mm256_sub_pd(vel2_x, _mm256_mul_pd(normal_x, impulse2)));
+    _mm256_storeu_pd(out[3].data(), _mm256_sub_pd(vel2_y, _mm256_mul_pd(normal_y, impulse2)));
 
-    return did_collide;
+    for (auto i : loop::end(4U))
+    {
+        if (((bits >> i) & 1U) == 0U) { continue; }
+        particles[pairs[i][0]].vel = {out[0][i], out[1][i]};
+        particles[pairs[i][1]].vel = {out[2][i], out[3][i]};
+    }
+    return static_cast<u64>(std::popcount(bits));
 }
+} // namespace detail
+#endif
 
 template <typename Float = f64>
 void collide(
     Particle<Float>& current, const LineSegment& l, f64 dt, f64 damping = 1.0, f64 friction = 1.0)
 {
-    const auto old_pos       = current.pos - current.vel * dt;
+    // line segments are in f64, so work in f64 and convert back at the end
+    const auto pos           = static_cast<Vector2>(current.pos);
+    auto vel                 = static_cast<Vector2>(current.vel);
+    const auto old_pos       = pos - vel * dt;
     const auto vec           = l.vector();
     const auto proj          = math::project(old_pos, l);
-    const auto normal_vector = current.pos - proj;
+    const auto normal_vector = pos - proj;
 
     const auto radius_shift =
         (proj - old_pos)
-            .with_length(current.radius); // keep track of the point on the circumference of
-                                          // prev closest to l, which will cross l first
+            .with_length(static_cast<f64>(current.radius)); // keep track of the point on the
+                                                            // circumference of prev closest to l,
+                                                            // which will cross l first
 
     const auto possible_collision =
-        math::clamped_intersection({old_pos + radius_shift, current.pos + radius_shift}, l);
+        math::clamped_intersection({old_pos + radius_shift, pos + radius_shift}, l);
 
     if (!possible_collision) { return; }
 
     const auto point = possible_collision.value();
 
-    auto leftover_vel = current.pos + radius_shift - point;
+    auto leftover_vel = pos + radius_shift - point;
     leftover_vel.reflect(vec);
-    current.vel.reflect(vec);
-    current.pos = point + leftover_vel - radius_shift + normal_vector.with_length(0.05);
+    vel.reflect(vec);
+    current.pos = (point + leftover_vel - radius_shift + normal_vector.with_length(0.05))
+                      .template cast<Float>();
+
+    vel.rotate(-vec.angle());
+    vel.x *= friction;
+    vel.y *= damping;
+    vel.rotate(vec.angle());
+    current.vel = vel.template cast<Float>();
+}
+
+namespace detail
+{
+// bounding box of a circle moving in a straight line
+[[nodiscard]] inline auto swept_bounds(Vector2 pos, Vector2 displacement, f64 radius) noexcept
+{
+    const auto end = pos + displacement;
+    return BoundingBox<f64>{{math::min(pos.x, end.x) - radius, math::min(pos.y, end.y) - radius},
+                            {math::max(pos.x, end.x) + radius, math::max(pos.y, end.y) + radius}};
+}
+} // namespace detail
+
+/**
+ * @brief               Collide with only the walls near the path of the particle over the last
+ * time step, found with a BVH
+ */
+template <typename Float = f64>
+void collide(
+    Particle<Float>& current, const BVH& walls, f64 dt, f64 damping = 1.0, f64 friction = 1.0)
+{
+    const auto vel  = static_cast<Vector2>(current.vel);
+    const auto path = detail::swept_bounds(static_cast<Vector2>(current.pos) - vel * dt, vel * dt,
+                                           static_cast<f64>(current.radius));
+    walls.for_each_in_box(path, [&](u32 /* index */, const LineSegment& wall)
+                          { collide(current, wall, dt, damping, friction); });
+}
+
+/**
+ * @brief               When, and where, a moving circle first touches a wall
+ */
+struct Impact
+{
+    f64 time{};       // fraction of the time step, in [0, 1]
+    Vector2 normal{}; // unit vector from the wall to the centre of the circle
+};
+
+/**
+ * @brief               Continuous collision detection of a circle moving in a straight line
+ * against a line segment: a ray cast against the segment thickened by the radius (a capsule).
+ * Only impacts while approaching the wall count, so a circle resting on a wall can leave it
+ *
+ * @param  pos          Centre of the circle at the start of the step
+ * @param  displacement Movement of the centre over the step
+ * @param  radius
+ * @param  wall
+ * @return Impact       If the circle touches the wall during the step
+ */
+[[nodiscard]] inline auto
+time_of_impact(Vector2 pos, Vector2 displacement, f64 radius, const LineSegment& wall) noexcept
+    -> std::optional<Impact>
+{
+    auto best = std::optional<Impact>{};
+
+    // the flat sides of the capsule
+    const auto vec = wall.vector();
+    if (const auto length_sq = vec.length_sq(); length_sq > 0.0)
+    {
+        auto normal   = Vector2{-vec.y, vec.x} / std::sqrt(length_sq);
+        auto distance = Vector2::dot(pos - wall.p1, normal);
+        if (distance < 0.0)
+        {
+            normal   = -normal;
+            distance = -distance;
+        }
+
+        const auto speed = Vector2::dot(displacement, normal);
+        if (speed < 0.0)
+        {
+            const auto time  = math::max((distance - radius) / -speed, 0.0);
+            const auto along = Vector2::dot(pos + displacement * time - wall.p1, vec) / length_sq;
+            if (time <= 1.0 && along >= 0.0 && along <= 1.0) { best = Impact{time, normal}; }
+        }
+    }
+
+    // the round ends of the capsule
+    for (const auto end : {wall.p1, wall.p2})
+    {
+        const auto offset = pos - end;
+        const auto a      = displacement.length_sq();
+        const auto b      = Vector2::dot(offset, displacement);
+        const auto c      = offset.length_sq() - radius * radius;
+        if (b >= 0.0 || a == 0.0) { continue; } // moving away
+
+        const auto discriminant = b * b - a * c;
+        if (discriminant < 0.0) { continue; }
+
+        const auto time = math::max((-b - std::sqrt(discriminant)) / a, 0.0);
+        if (time > 1.0 || (best && best->time <= time)) { continue; }
+
+        const auto normal = offset + displacement * time;
+        best              = Impact{time, normal / normal.length()};
+    }
+
+    return best;
+}
+
+/**
+ * @brief               Semi-implicit Euler update which sweeps each particle against the walls
+ * instead of letting it tunnel through them. A particle stops at its earliest impact, bounces, and
+ * uses the rest of the step only if that doesn't take it into another wall: at most one bounce per
+ * step
+ *
+ * @param  particles
+ * @param  walls        A BVH, or any range of LineSegment such as Mesh::edges_view()
+ * @param  dt           Time step
+ * @param  damping      Coefficient of restitution
+ * @param  friction     Fraction of the tangential velocity kept after a bounce
+ * @return u64          Number of bounces
+ */
+template <typename Float = f64>
+auto update_swept(std::span<Particle<Float>> particles,
+                  const auto& walls,
+                  f64 dt,
+                  f64 damping  = 1.0,
+                  f64 friction = 1.0) -> u64
+{
+    // earliest impact over all walls, skipping those whose bounding box the path can't reach
+    const auto first_impact = [&](Vector2 pos, Vector2 displacement, f64 radius)
+    {
+        const auto path = detail::swept_bounds(pos, displacement, radius);
+        auto best       = std::optional<Impact>{};
+        const auto test = [&](const LineSegment& wall)
+        {
+            const auto impact = time_of_impact(pos, displacement, radius, wall);
+            if (impact && (!best || impact->time < best->time)) { best = impact; }
+        };
+
+        if constexpr (std::is_same_v<std::remove_cvref_t<decltype(walls)>, BVH>)
+        {
+            walls.for_each_in_box(path,
+                                  [&](u32 /* index */, const LineSegment& wall) { test(wall); });
+        }
+        else
+        {
+            for (const LineSegment& wall : walls)
+            {
+                if (math::max(wall.p1.x, wall.p2.x) < path.min.x ||
+                    math::min(wall.p1.x, wall.p2.x) > path.max.x ||
+                    math::max(wall.p1.y, wall.p2.y) < path.min.y ||
+                    math::min(wall.p1.y, wall.p2.y) > path.max.y)
+                {
+                    continue;
+                }
+                test(wall);
+            }
+        }
+        return best;
+    };
+
+    auto bounces = u64{};
+    for (auto& particle : particles)
+    {
+        particle.vel += particle.acc * static_cast<Float>(dt);
+        particle.acc = Vector2_t<Float>{};
+
+        auto pos          = static_cast<Vector2>(particle.pos);
+        auto vel          = static_cast<Vector2>(particle.vel);
+        const auto radius = static_cast<f64>(particle.radius);
+
+        const auto impact = first_impact(pos, vel * dt, radius);
+        if (!impact)
+        {
+            particle.pos = (pos + vel * dt).template cast<Float>();
+            continue;
+        }
+
+        bounces++;
+        pos += vel * (dt * impact->time);
+
+        const auto normal_speed = Vector2::dot(vel, impact->normal);
+        const auto tangent      = vel - impact->normal * normal_speed;
+        vel                     = tangent * friction - impact->normal * (normal_speed * damping);
+
+        const auto remaining = vel * (dt * (1.0 - impact->time));
+        if (!first_impact(pos, remaining, radius)) { pos += remaining; }
 
-    current.vel.rotate(-vec.angle());
-    current.vel.x *= friction;
-    current.vel.y *= damping;
-    current.vel.rotate(vec.angle());
+        particle.pos = pos.template cast<Float>();
+        particle.vel = vel.template cast<Float>();
+    }
+    return bounces;
 }
 } // namespace sm::phys
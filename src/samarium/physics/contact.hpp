@@ -0,0 +1,255 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <array>   // for array
+#include <limits>  // for numeric_limits
+#include <span>    // for span
+#include <utility> // for pair
+
+#include "samarium/core/types.hpp"   // for f64, u32, u64
+#include "samarium/math/Vector2.hpp" // for Vector2_t
+#include "samarium/math/loop.hpp"    // for end
+#include "samarium/math/math.hpp"    // for min
+
+namespace sm::phys
+{
+/**
+ * @brief               A point where 2 shapes touch
+ */
+template <typename Float = f64> struct ContactPoint
+{
+    Vector2_t<Float> pos{}; // halfway between the surfaces
+    Float separation{};     // negative when the shapes overlap
+    u32 id{};               // the features which touch, to follow the point from step to step
+};
+
+/**
+ * @brief               Up to 2 points where 2 shapes touch, with a shared normal
+ */
+template <typename Float = f64> struct Manifold
+{
+    Vector2_t<Float> normal{}; // from the first shape to the second
+    u32 count{};
+    std::array<ContactPoint<Float>, 2> points{};
+};
+
+/**
+ * @brief               A Collider placed in the world
+ */
+template <typename Float = f64> struct PlacedCollider
+{
+    Vector2_t<Float> centre{};
+    Float radius{};
+    std::span<const Vector2_t<Float>> vertices{}; // counter-clockwise, empty for a circle
+    std::span<const Vector2_t<Float>> normals{};  // outward normal of the edge starting at vertex i
+};
+
+namespace detail
+{
+template <typename Float> struct ClipVertex
+{
+    Vector2_t<Float> pos{};
+    u32 id{};
+};
+
+template <typename Float> using ClipSegment = std::array<ClipVertex<Float>, 2>;
+
+// keep the part of a segment where dot(direction, pos) <= offset. Returns false if none of the
+// segment is left, which happens only when the shapes barely touch
+template <typename Float>
+[[nodiscard]] auto clip(ClipSegment<Float>& segment,
+                        Vector2_t<Float> direction,
+                        Float offset,
+                        u32 clip_id) noexcept -> bool
+{
+    const auto distance0 = Vector2_t<Float>::dot(direction, segment[0].pos) - offset;
+    const auto distance1 = Vector2_t<Float>::dot(direction, segment[1].pos) - offset;
+    if (distance0 <= Float{0} && distance1 <= Float{0}) { return true; }
+    if (distance0 > Float{0} && distance1 > Float{0}) { return false; }
+
+    const auto factor = distance0 / (distance0 - distance1);
+    const auto pos    = segment[0].pos + (segment[1].pos - segment[0].pos) * factor;
+    segment[distance0 > Float{0} ? 0 : 1] = {pos, clip_id};
+    return true;
+}
+
+template <typename Float>
+[[nodiscard]] auto collide_circles(const PlacedCollider<Float>& a,
+                                   const PlacedCollider<Float>& b) noexcept -> Manifold<Float>
+{
+    const auto vec      = b.centre - a.centre;
+    const auto radii    = a.radius + b.radius;
+    const auto distance = vec.length();
+    if (distance > radii) { return {}; }
+
+    const auto normal     = distance == Float{0} ? Vector2_t<Float>{0, 1} : vec / distance;
+    const auto separation = distance - radii;
+    const auto pos        = a.centre + normal * (a.radius + separation / Float{2});
+    return {normal, 1, {{{pos, separation}}}};
+}
+
+// normal from the polygon a to the circle b
+template <typename Float>
+[[nodiscard]] auto collide_polygon_circle(const PlacedCollider<Float>& a,
+                                          const PlacedCollider<Float>& b) noexcept
+    -> Manifold<Float>
+{
+    const auto count = a.vertices.size();
+    auto separation  = -std::numeric_limits<Float>::infinity();
+    auto edge        = u64{};
+    for (auto i : loop::end(count))
+    {
+        const auto distance = Vector2_t<Float>::dot(a.normals[i], b.centre - a.vertices[i]);
+        if (distance > b.radius) { return {}; }
+        if (distance > separation)
+        {
+            separation = distance;
+            edge       = i;
+        }
+    }
+
+    const auto v1 = a.vertices[edge];
+    const auto v2 = a.vertices[(edge + 1) % count];
+    auto normal   = a.normals[edge];
+    auto id       = static_cast<u32>(edge);
+
+    // outside the polygon and past an end of the closest edge, the closest feature is a vertex
+    const auto closest_vertex = [&](Vector2_t<Float> vertex, u64 index)
+    {
+        const auto vec      = b.centre - vertex;
+        const auto distance = vec.length();
+        if (distance > b.radius) { return false; }
+        normal     = vec / distance;
+        separation = distance;
+        id         = 0x100U | static_cast<u32>(index);
+        return true;
+    };
+
+    if (separation > Float{0})
+    {
+        if (Vector2_t<Float>::dot(b.centre - v1, v2 - v1) <= Float{0})
+        {
+            if (!closest_vertex(v1, edge)) { return {}; }
+        }
+        else if (Vector2_t<Float>::dot(b.centre - v2, v1 - v2) <= Float{0})
+        {
+            if (!closest_vertex(v2, (edge + 1) % count)) { return {}; }
+        }
+    }
+
+    separation -= b.radius;
+    const auto pos = b.centre - normal * (b.radius + separation / Float{2});
+    return {normal, 1, {{{pos, separation, id}}}};
+}
+
+// largest distance of b in front of an edge of a, and that edge. Negative if they overlap
+template <typename Float>
+[[nodiscard]] auto max_separation(const PlacedCollider<Float>& a,
+                                  const PlacedCollider<Float>& b) noexcept -> std::pair<Float, u64>
+{
+    auto max  = -std::numeric_limits<Float>::infinity();
+    auto edge = u64{};
+    for (auto i : loop::end(a.vertices.size()))
+    {
+        auto min = std::numeric_limits<Float>::infinity();
+        for (const auto& vertex : b.vertices)
+        {
+            min = math::min(min, Vector2_t<Float>::dot(a.normals[i], vertex - a.vertices[i]));
+        }
+        if (min > max)
+        {
+            max  = min;
+            edge = i;
+        }
+    }
+    return {max, edge};
+}
+
+// separating axis test, then clip the edge of one polygon against the sides of the other's edge
+template <typename Float>
+[[nodiscard]] auto collide_polygons(const PlacedCollider<Float>& a,
+                                    const PlacedCollider<Float>& b) noexcept -> Manifold<Float>
+{
+    const auto [separation_a, edge_a] = max_separation(a, b);
+    if (separation_a > Float{0}) { return {}; }
+    const auto [separation_b, edge_b] = max_separation(b, a);
+    if (separation_b > Float{0}) { return {}; }
+
+    // prefer the edges of a, so the choice doesn't flicker between steps when both are as good
+    const auto tolerance = static_cast<Float>(1e-3) * (a.radius + b.radius);
+    const auto flip      = separation_b > separation_a + tolerance;
+    const auto& ref      = flip ? b : a;
+    const auto& inc      = flip ? a : b;
+    const auto edge      = flip ? edge_b : edge_a;
+    const auto normal    = ref.normals[edge];
+
+    // the incident edge faces the reference edge most directly
+    auto incident = u64{};
+    auto min_dot  = std::numeric_limits<Float>::infinity();
+    for (auto i : loop::end(inc.normals.size()))
+    {
+        const auto dot = Vector2_t<Float>::dot(normal, inc.normals[i]);
+        if (dot < min_dot)
+        {
+            min_dot  = dot;
+            incident = i;
+        }
+    }
+
+    const auto next_incident = (incident + 1) % inc.vertices.size();
+    auto segment = ClipSegment<Float>{{{inc.vertices[incident], static_cast<u32>(incident)},
+                                       {inc.vertices[next_incident],
+                                        static_cast<u32>(next_incident)}}};
+
+    const auto v1      = ref.vertices[edge];
+    const auto v2      = ref.vertices[(edge + 1) % ref.vertices.size()];
+    const auto tangent = (v2 - v1).normalized();
+    // ids: the incident vertex in the low 8 bits, or instead the side of the reference edge which
+    // clipped it in bit 17 or 18, the reference edge in bits 8 to 15, and bit 16 if flipped
+    if (!clip(segment, -tangent, -Vector2_t<Float>::dot(tangent, v1), 0x20000U) ||
+        !clip(segment, tangent, Vector2_t<Float>::dot(tangent, v2), 0x40000U))
+    {
+        return {};
+    }
+
+    auto manifold   = Manifold<Float>{flip ? -normal : normal};
+    const auto base = (flip ? 0x10000U : 0U) | (static_cast<u32>(edge) << 8U);
+    for (const auto& [pos, id] : segment)
+    {
+        const auto separation = Vector2_t<Float>::dot(normal, pos - v1);
+        if (separation > Float{0}) { continue; }
+        manifold.points[manifold.count++] = {pos - normal * (separation / Float{2}), separation,
+                                             base | id};
+    }
+    return manifold;
+}
+} // namespace detail
+
+/**
+ * @brief               Find where 2 shapes touch
+ *
+ * @return Manifold     With a count of 0 if they don't
+ */
+template <typename Float>
+[[nodiscard]] auto collide(const PlacedCollider<Float>& a, const PlacedCollider<Float>& b) noexcept
+    -> Manifold<Float>
+{
+    const auto a_circle = a.vertices.empty();
+    const auto b_circle = b.vertices.empty();
+    if (a_circle && b_circle) { return detail::collide_circles(a, b); }
+    if (b_circle) { return detail::collide_polygon_circle(a, b); }
+    if (a_circle)
+    {
+        auto manifold   = detail::collide_polygon_circle(b, a);
+        manifold.normal = -manifold.normal;
+        return manifold;
+    }
+    return detail::collide_polygons(a, b);
+}
+} // namespace sm::phys
@@ -0,0 +1,115 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <algorithm>   // for clamp
+#include <type_traits> // for remove_cvref_t
+
+#include "samarium/core/types.hpp"       // for f64, u64
+#include "samarium/math/BoundingBox.hpp" // for BoundingBox
+#include "samarium/math/Vector2.hpp"     // for Vector2, Vector2_t
+#include "samarium/math/loop.hpp"        // for end
+
+#include "RigidBodySystem.hpp" // for RigidBodySystem
+#include "contact.hpp"         // for collide, PlacedCollider
+
+namespace sm::phys
+{
+/**
+ * @brief               Collide the particles of a ParticleSystem with the bodies of a
+ * RigidBodySystem, both ways. Each body looks up the particles around it in the spatial index of
+ * the particles, so the cost grows with the number of particles near bodies, not with particles x
+ * bodies
+ *
+ * Particles are pushed out of the bodies and bounce off them at once. The impulses on each body
+ * are summed into its acc and a_acc, so they move it in its next step
+ *
+ * Call after ParticleSystem::self_collision(), which builds the spatial index
+ *
+ * @param  particles    A ParticleSystem
+ * @param  bodies
+ * @param  time_delta   Time step of the bodies, to turn impulses into forces
+ * @param  damping      Coefficient of restitution
+ * @param  friction     Coefficient of friction
+ * @return u64          Number of collisions
+ */
+template <typename ParticleSystem_t, typename Float>
+auto couple(ParticleSystem_t& particles,
+            RigidBodySystem<Float>& bodies,
+            Float time_delta,
+            f64 damping  = 1.0,
+            f64 friction = 0.0) -> u64
+{
+    using Vector_t         = Vector2_t<Float>;
+    const auto restitution = static_cast<Float>(damping);
+    const auto max_ratio   = static_cast<Float>(friction);
+
+    bodies.place();
+    auto collisions = u64{};
+    for (auto b : loop::end(bodies.size()))
+    {
+        auto& body                 = bodies.bodies[b];
+        const auto shape           = bodies.placed(b);
+        const auto inverse_mass    = Float{1} / body.mass;
+        const auto inverse_inertia = Float{1} / body.a_mass;
+        auto impulse_sum           = Vector_t{};
+        auto angular_sum           = Float{};
+
+        const auto collide_particle = [&](auto& particle)
+        {
+            using ParticleFloat = typename std::remove_cvref_t<decltype(particle)>::value_type;
+
+            const auto circle   = PlacedCollider<Float>{static_cast<Vector_t>(particle.pos),
+                                                        static_cast<Float>(particle.radius)};
+            const auto manifold = collide(shape, circle);
+            if (manifold.count == 0) { return false; }
+
+            const auto& point = manifold.points[0];
+            const auto normal = manifold.normal;
+            particle.pos -= static_cast<Vector2_t<ParticleFloat>>(normal * point.separation);
+
+            const auto rel      = point.pos - body.pos;
+            const auto relative = static_cast<Vector_t>(particle.vel) - body.velocity_at(rel);
+            const auto approach = Vector_t::dot(relative, normal);
+            // a particle which was pushed out must wake up, even if it gets no impulse
+            if (approach >= Float{0}) { return point.separation < Float{0}; }
+
+            // impulse on the particle, with the same response as RigidBodySystem's contacts
+            const auto inverse_sum = Float{1} / static_cast<Float>(particle.mass) + inverse_mass;
+            const auto response    = [&](Vector_t direction)
+            {
+                const auto cross = Vector_t::cross(rel, direction);
+                return inverse_sum + inverse_inertia * cross * cross;
+            };
+
+            const auto tangent        = Vector_t{normal.y, -normal.x};
+            const auto normal_impulse = -(Float{1} + restitution) * approach / response(normal);
+            const auto max_friction   = max_ratio * normal_impulse;
+            const auto tangent_impulse =
+                std::clamp(-Vector_t::dot(relative, tangent) / response(tangent), -max_friction,
+                           max_friction);
+
+            const auto impulse = normal * normal_impulse + tangent * tangent_impulse;
+            particle.vel += static_cast<Vector2_t<ParticleFloat>>(
+                impulse / static_cast<Float>(particle.mass));
+            impulse_sum -= impulse;
+            angular_sum -= Vector_t::cross(rel, impulse);
+            collisions++;
+            return true;
+        };
+
+        const auto centre = static_cast<Vector2>(body.pos);
+        const auto half   = Vector2::combine(static_cast<f64>(shape.radius));
+        particles.for_each_overlapping({centre - half, centre + half}, collide_particle);
+
+        body.apply_force(impulse_sum / time_delta);
+        body.apply_torque(angular_sum / time_delta);
+    }
+    return collisions;
+}
+} // namespace sm::phys
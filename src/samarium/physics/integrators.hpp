@@ -0,0 +1,157 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <span>   // for span
+#include <vector> // for vector
+
+#include "samarium/core/types.hpp"       // for f64, u32, u64
+#include "samarium/math/Vector2.hpp"     // for Vector2_t
+#include "samarium/math/loop.hpp"        // for end
+#include "samarium/util/radix_sort.hpp" // for permute
+
+#include "Particle.hpp" // for Particle
+
+namespace sm::phys
+{
+/**
+ * Integrators advance particles by one time step. Each has the same interface:
+ *
+ *     integrator.step(particles, time_delta, apply_forces, project_constraints)
+ *
+ * `apply_forces()` accumulates forces into `acc` (it may be called more than once per step) and
+ * `project_constraints()` moves positions to satisfy constraints after the particles have moved.
+ * `integrator.reorder(new_index)` follows the particles when they are reordered
+ */
+
+/**
+ * @brief               Semi-implicit (symplectic) Euler, the same as Particle::update(). Projected
+ * positions do not change velocities
+ */
+struct SemiImplicitEuler
+{
+    template <typename Float>
+    void step(std::span<Particle<Float>> particles,
+              Float time_delta,
+              auto&& apply_forces,
+              auto&& project_constraints)
+    {
+        apply_forces();
+        for (auto& particle : particles) { particle.update(time_delta); }
+        project_constraints();
+    }
+
+    void reorder(std::span<const u32> /* new_index */) {}
+};
+
+/**
+ * @brief               Position (Störmer) Verlet: x' = 2x - x_prev + a dt^2. Velocities are
+ * derived from the change in position, so constraint projection also corrects them, which keeps
+ * stiff constraints stable at large time steps
+ */
+template <typename Float = f64> struct PositionVerlet
+{
+    std::vector<Vector2_t<Float>> previous_pos{};
+
+    void step(std::span<Particle<Float>> particles,
+              Float time_delta,
+              auto&& apply_forces,
+              auto&& project_constraints)
+    {
+        if (previous_pos.size() != particles.size())
+        {
+            // start from the current velocities
+            previous_pos.resize(particles.size());
+            for (auto i : loop::end(particles.size()))
+            {
+                previous_pos[i] = particles[i].pos - particles[i].vel * time_delta;
+            }
+        }
+
+        apply_forces();
+        const auto dt_sq = time_delta * time_delta;
+        for (auto i : loop::end(particles.size()))
+        {
+            auto& particle  = particles[i];
+            const auto pos  = particle.pos;
+            particle.pos    = pos + (pos - previous_pos[i]) + particle.acc * dt_sq;
+            particle.acc    = Vector2_t<Float>{};
+            previous_pos[i] = pos;
+        }
+
+        project_constraints();
+        for (auto i : loop::end(particles.size()))
+        {
+            particles[i].vel = (particles[i].pos - previous_pos[i]) / time_delta;
+        }
+    }
+
+    void reorder(std::span<const u32> new_index)
+    {
+        if (previous_pos.size() == new_index.size()) { util::permute(previous_pos, new_index); }
+    }
+};
+
+/**
+ * @brief               Velocity Verlet: second order in both position and velocity, at the cost
+ * of evaluating forces at the start and at the end of the first step
+ */
+template <typename Float = f64> struct VelocityVerlet
+{
+    std::vector<Vector2_t<Float>> previous_acc{};
+    std::vector<Vector2_t<Float>> unprojected_pos{};
+
+    void step(std::span<Particle<Float>> particles,
+              Float time_delta,
+              auto&& apply_forces,
+              auto&& project_constraints)
+    {
+        const auto half_dt = time_delta / Float{2};
+
+        if (previous_acc.size() != particles.size())
+        {
+            previous_acc.resize(particles.size());
+            unprojected_pos.resize(particles.size());
+            apply_forces();
+            for (auto i : loop::end(particles.size()))
+            {
+                previous_acc[i]  = particles[i].acc;
+                particles[i].acc = Vector2_t<Float>{};
+            }
+        }
+
+        for (auto i : loop::end(particles.size()))
+        {
+            auto& particle = particles[i];
+            particle.pos += (particle.vel + previous_acc[i] * half_dt) * time_delta;
+        }
+
+        apply_forces();
+        for (auto i : loop::end(particles.size()))
+        {
+            auto& particle = particles[i];
+            particle.vel += (previous_acc[i] + particle.acc) * half_dt;
+
+            previous_acc[i]    = particle.acc;
+            particle.acc       = Vector2_t<Float>{};
+            unprojected_pos[i] = particle.pos;
+        }
+
+        project_constraints();
+        for (auto i : loop::end(particles.size()))
+        {
+            particles[i].vel += (particles[i].pos - unprojected_pos[i]) / time_delta;
+        }
+    }
+
+    void reorder(std::span<const u32> new_index)
+    {
+        if (previous_acc.size() == new_index.size()) { util::permute(previous_acc, new_index); }
+    }
+};
+} // namespace sm::phys
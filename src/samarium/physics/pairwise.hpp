@@ -0,0 +1,124 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <cmath>       // for sqrt
+#include <type_traits> // for remove_cvref_t
+
+#include "samarium/util/Error.hpp"         // for Error
+#include "samarium/util/SweepAndPrune.hpp" // for SweepAndPrune
+#include "samarium/util/ThreadPool.hpp"    // for ThreadPool
+
+#include "VerletList.hpp" // for VerletList
+
+namespace sm::phys
+{
+/**
+ * @brief               How a kernel of for_each_pair_within() acts on a pair
+ */
+enum class Symmetry
+{
+    Symmetric, // called once per pair, and changes both particles
+    Asymmetric // called once each way, and only changes the first particle
+};
+
+namespace detail
+{
+// skip pairs at or beyond `radius`, and call `kernel` once or twice for the others
+template <Symmetry symmetry, typename Float>
+[[nodiscard]] auto pair_within(Float radius, auto& kernel) noexcept
+{
+    return [&kernel, radius_sq = radius * radius](auto& a, auto& b)
+    {
+        const auto vec         = b.pos - a.pos;
+        const auto distance_sq = vec.length_sq();
+        if (distance_sq >= radius_sq) { return; }
+
+        const auto distance = std::sqrt(distance_sq);
+        kernel(a, b, vec, distance);
+        if constexpr (symmetry == Symmetry::Asymmetric) { kernel(b, a, -vec, distance); }
+    };
+}
+
+template <typename T> constexpr auto is_sweep_and_prune                   = false;
+template <typename T> constexpr auto is_sweep_and_prune<SweepAndPrune<T>> = true;
+
+// pairs are found in adjacent cells, so those must be at least `radius` wide
+template <typename ParticleSystem_t>
+void check_spacing(const ParticleSystem_t& system, typename ParticleSystem_t::Float radius)
+{
+    static_assert(!is_sweep_and_prune<std::remove_cvref_t<decltype(system.hash_grid)>>,
+                  "for_each_pair_within() needs a grid: SweepAndPrune pairs by the particle radii");
+    if (static_cast<f64>(radius) > system.hash_grid.spacing)
+    {
+        throw Error{"for_each_pair_within(): radius is larger than the grid spacing"};
+    }
+}
+} // namespace detail
+
+/**
+ * @brief               Call `kernel` for every pair of particles closer than `radius`, for
+ * interactions with a cutoff such as particle life or Lennard-Jones. The spatial index is rebuilt
+ * once, then pairs are visited half-shell, without allocating once the system has warmed up
+ *
+ * A Symmetric kernel is called as `kernel(a, b, vec, distance)` once per pair, where `vec` goes
+ * from a to b, and usually applies equal and opposite forces. An Asymmetric kernel is called as
+ * `kernel(on, due_to, vec, distance)` both ways round, for effects which depend on the order,
+ * such as a matrix of forces between types. Only awake particles take part
+ *
+ * @tparam symmetry     Symmetry::Symmetric or Symmetry::Asymmetric
+ * @param  system       A ParticleSystem with a HashGrid or UniformGrid of spacing at least
+ * `radius`, else it throws sm::Error
+ * @param  radius       Cutoff distance
+ * @param  kernel
+ */
+template <Symmetry symmetry = Symmetry::Symmetric, typename ParticleSystem_t>
+void for_each_pair_within(ParticleSystem_t& system,
+                          typename ParticleSystem_t::Float radius,
+                          auto&& kernel)
+{
+    detail::check_spacing(system, radius);
+    system.rebuild_hash_grid();
+    system.for_each_pair(detail::pair_within<symmetry>(radius, kernel));
+}
+
+/**
+ * @brief               Call `kernel` for every pair of particles closer than `radius`, using
+ * multiple threads. Calls on the same particle never overlap, so the kernel needs no locks
+ */
+template <Symmetry symmetry = Symmetry::Symmetric, typename ParticleSystem_t>
+void for_each_pair_within(ParticleSystem_t& system,
+                          typename ParticleSystem_t::Float radius,
+                          auto&& kernel,
+                          ThreadPool& thread_pool)
+{
+    detail::check_spacing(system, radius);
+    system.rebuild_hash_grid();
+    system.for_each_pair(thread_pool, detail::pair_within<symmetry>(radius, kernel));
+}
+
+/**
+ * @brief               Call `kernel` for every pair of particles closer than `radius`, taking the
+ * pairs from a VerletList, which is only rebuilt when the particles have moved far enough
+ *
+ * @param  neighbor_list With a cutoff of at least `radius`, else it throws sm::Error
+ */
+template <Symmetry symmetry = Symmetry::Symmetric, typename ParticleSystem_t>
+void for_each_pair_within(ParticleSystem_t& system,
+                          typename ParticleSystem_t::Float radius,
+                          auto&& kernel,
+                          VerletList<typename ParticleSystem_t::Float>& neighbor_list)
+{
+    if (radius > neighbor_list.cutoff)
+    {
+        throw Error{"for_each_pair_within(): radius is larger than the cutoff of the list"};
+    }
+    neighbor_list.update(system.particles);
+    neighbor_list.for_each_pair(system.particles, detail::pair_within<symmetry>(radius, kernel));
+}
+} // namespace sm::phys
@@ -17,11 +17,16 @@
 #include "samarium/util/SourceLocation.hpp"
 #include "samarium/util/StaticVector.hpp"
 #include "samarium/util/Stopwatch.hpp"
+#include "samarium/util/SweepAndPrune.hpp"
+#include "samarium/util/TaskGraph.hpp"
+#include "samarium/util/TripleBuffer.hpp"
+#include "samarium/util/UniformGrid.hpp"
 #include "samarium/util/byte_size.hpp"
 #include "samarium/util/file.hpp"
 #include "samarium/util/format.hpp"
 #include "samarium/util/noise.hpp"
 #include "samarium/util/print.hpp"
+#include "samarium/util/radix_sort.hpp"
 #include "samarium/util/run.hpp"
 #include "samarium/util/unordered.hpp"
 #include "samarium/util/util.hpp"
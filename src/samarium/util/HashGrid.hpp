@@ -8,12 +8,15 @@
 #pragma once
 
 #include <array>
+#include <span>
 
 #include "range/v3/algorithm/copy.hpp"
 
 #include "samarium/core/types.hpp"
+#include "samarium/math/BoundingBox.hpp"
 #include "samarium/math/Extents.hpp"
 #include "samarium/math/Vector2.hpp"
+#include "samarium/math/loop.hpp"
 #include "samarium/math/math.hpp"
 
 #include "SmallVector.hpp"
@@ -33,12 +36,42 @@ template <typename T, usize CellInlineCapacity = 127> struct HashGrid
 
     auto to_coords(Vector2 pos) const
     {
-        return Key::make(math::floor_to_nearest(pos.x, spacing),
-                         math::floor_to_nearest(pos.y, spacing));
+        return Key::make(std::floor(pos.x / spacing), std::floor(pos.y / spacing));
     }
 
     auto insert(Vector2 pos, T value) { map[to_coords(pos)].push_back(value); }
 
+    /**
+     * @brief               Replace the contents of the grid with the indices of `positions`
+     *
+     * @param  positions    Sized range of Vector2_t of any floating point type
+     */
+    template <typename Positions> void rebuild(const Positions& positions)
+    {
+        map.clear();
+        map.reserve(static_cast<u64>(positions.size()));
+        auto i = T{};
+        for (const auto& pos : positions) { insert(static_cast<Vector2>(pos), i++); }
+    }
+
+    auto cell(Key key) const -> std::span<const T>
+    {
+        const auto iter = map.find(key);
+        if (iter == map.end()) { return {}; }
+        return {iter->second.data(), iter->second.size()};
+    }
+
+    /**
+     * @brief               Call `callable(key, values)` for every non-empty cell
+     */
+    void for_each_cell(auto&& callable) const
+    {
+        for (const auto& [key, values] : map)
+        {
+            callable(key, std::span<const T>{values.data(), values.size()});
+        }
+    }
+
     auto cell_containing(Vector2 pos) -> typename Container::iterator
     {
         return map.find(to_coords(pos));
@@ -49,20 +82,97 @@ template <typename T, usize CellInlineCapacity = 127> struct HashGrid
         return map.find(to_coords(pos));
     }
 
-    auto neighbors(Vector2 pos) const
+    /**
+     * @brief               The 3x3 cells around `key`, each looked up once. Missing cells are
+     * empty spans
+     */
+    auto neighbor_cells(Key key) const
+    {
+        auto cells = std::array<std::span<const T>, 9>{};
+        auto index = 0UL;
+        for (auto y : loop::start_end(key.y - 1, key.y + 2))
+        {
+            for (auto x : loop::start_end(key.x - 1, key.x + 2)) { cells[index++] = cell({x, y}); }
+        }
+        return cells;
+    }
+
+    auto neighbor_cells(Vector2 pos) const { return neighbor_cells(to_coords(pos)); }
+
+    /**
+     * @brief               Call `callable(value)` for every value in the 3x3 cells around `pos`,
+     * without copying them
+     */
+    void for_each_neighbor(Vector2 pos, auto&& callable) const
+    {
+        for (const auto& cell_ : neighbor_cells(pos))
+        {
+            for (auto value : cell_) { callable(value); }
+        }
+    }
+
+    /**
+     * @brief               Call `callable(value)` for every value in the cells which overlap `box`
+     */
+    void for_each_overlapping(const BoundingBox<f64>& box, auto&& callable) const
     {
-        constexpr auto offsets = std::to_array<Vector2>(
-            {{0, 0}, {-1, -1}, {-1, 0}, {-1, 1}, {0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}});
+        const auto min = to_coords(box.min);
+        const auto max = to_coords(box.max);
+        for (auto y : loop::start_end(min.y, max.y + 1))
+        {
+            for (auto x : loop::start_end(min.x, max.x + 1))
+            {
+                for (auto value : cell({x, y})) { callable(value); }
+            }
+        }
+    }
 
-        auto out = SmallVector<T, math::min(CellInlineCapacity * offsets.size(), u64(127))>();
+    /**
+     * @brief               The 4 cells after `key` in a half-shell: (+1, 0), (-1, +1), (0, +1) and
+     * (+1, +1). Every pair of adjacent cells appears exactly once as (cell, forward neighbour)
+     */
+    auto forward_neighbor_cells(Key key) const
+    {
+        return std::array<std::span<const T>, 4>{cell({key.x + 1, key.y}),
+                                                 cell({key.x - 1, key.y + 1}),
+                                                 cell({key.x, key.y + 1}),
+                                                 cell({key.x + 1, key.y + 1})};
+    }
 
-        for (auto offset : offsets)
+    /**
+     * @brief               Call `callable(i, j)` once for every pair owned by the cell `key`: pairs
+     * inside the cell and pairs with its forward neighbours
+     */
+    void for_each_pair(Key key, auto&& callable) const
+    {
+        const auto values = cell(key);
+        for (auto a : loop::end(values.size()))
         {
-            const auto iter = cell_containing(pos + offset * spacing);
-            if (iter == map.end()) { continue; }
-            for (const auto& i : iter->second) { out.push_back(i); }
+            for (auto b : loop::start_end(a + 1, values.size())) { callable(values[a], values[b]); }
         }
 
+        for (const auto& neighbor : forward_neighbor_cells(key))
+        {
+            for (auto i : values)
+            {
+                for (auto j : neighbor) { callable(i, j); }
+            }
+        }
+    }
+
+    /**
+     * @brief               Call `callable(i, j)` once for every pair of values in the same or
+     * adjacent cells
+     */
+    void for_each_pair(auto&& callable) const
+    {
+        for (const auto& [key, values] : map) { for_each_pair(key, callable); }
+    }
+
+    auto neighbors(Vector2 pos) const
+    {
+        auto out = SmallVector<T, math::min(CellInlineCapacity * 9, u64(127))>();
+        for_each_neighbor(pos, [&](T value) { out.push_back(value); });
         return out;
     }
 };
@@ -0,0 +1,231 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <algorithm> // for sort, lower_bound
+#include <span>      // for span
+#include <vector>    // for vector
+
+#include "samarium/core/types.hpp"       // for f64, i32, u32, u64
+#include "samarium/math/BoundingBox.hpp" // for BoundingBox
+#include "samarium/math/Vector2.hpp"     // for Vector2, Vector2_t
+#include "samarium/math/loop.hpp"        // for end, start_end
+#include "samarium/math/math.hpp"        // for min, max
+
+namespace sm
+{
+/**
+ * @brief               Sort and sweep broadphase. Values are kept sorted by the start of their
+ * interval along one axis, and pairs are found by sweeping along it. Each value has its own size,
+ * so there is no cell size to tune when sizes vary a lot. Rebuilds insertion sort the order of the
+ * last rebuild, which is nearly sorted when values move a little between frames
+ *
+ * Shares the interface of HashGrid and UniformGrid, as a single cell holding every value
+ *
+ * @tparam T            Type of the values stored, usually an index
+ */
+template <typename T = u32> struct SweepAndPrune
+{
+    using Key = Vector2_t<i32>;
+
+    struct Entry
+    {
+        f64 min{};       // start of the interval along the sweep axis
+        f64 max{};       // end of the interval along the sweep axis
+        f64 cross_min{}; // start of the interval along the other axis
+        f64 cross_max{}; // end of the interval along the other axis
+        T value{};
+    };
+
+    f64 spacing;                           // size of every value when rebuilt without radii
+    u64 axis{};                            // 0 to sweep along x, 1 along y
+    f64 max_extent{};                      // longest interval along the sweep axis
+    std::vector<Entry> entries{};          // sorted by min
+    std::vector<BoundingBox<f64>> boxes{}; // box of each value, scratch space for rebuilds
+
+    /**
+     * @param  spacing_     Size of every value when rebuilt from positions alone
+     */
+    explicit SweepAndPrune(f64 spacing_ = 1.0) : spacing{spacing_} {}
+
+    /**
+     * @brief               Replace the contents with the indices of `positions`, each `spacing`
+     * wide
+     *
+     * @param  positions    Sized range of Vector2_t of any floating point type
+     */
+    template <typename Positions> void rebuild(const Positions& positions)
+    {
+        boxes.clear();
+        for (const auto& pos : positions) { add(static_cast<Vector2>(pos), spacing / 2.0); }
+        sort();
+    }
+
+    /**
+     * @brief               Replace the contents with the indices of circles
+     *
+     * @param  positions    Sized range of Vector2_t of any floating point type
+     * @param  radii        Range of the radius of each position
+     */
+    template <typename Positions, typename Radii>
+    void rebuild(const Positions& positions, const Radii& radii)
+    {
+        boxes.clear();
+        auto radius = radii.begin();
+        for (const auto& pos : positions)
+        {
+            add(static_cast<Vector2>(pos), static_cast<f64>(*radius));
+            ++radius;
+        }
+        sort();
+    }
+
+    /**
+     * @brief               Call `callable(key, entries)` for the single cell, if not empty
+     */
+    void for_each_cell(auto&& callable) const
+    {
+        if (!entries.empty()) { callable(Key{}, std::span<const Entry>{entries}); }
+    }
+
+    /**
+     * @brief               Call `callable(i, j)` once for every pair of values whose boxes overlap
+     */
+    void for_each_pair(auto&& callable) const
+    {
+        const auto count = entries.size();
+        for (auto i : loop::end(count))
+        {
+            const auto& a = entries[i];
+            for (auto j = i + 1; j < count && entries[j].min <= a.max; j++)
+            {
+                const auto& b = entries[j];
+                if (b.cross_min <= a.cross_max && a.cross_min <= b.cross_max)
+                {
+                    callable(a.value, b.value);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief               The same as for_each_pair(callable), as there is only one cell
+     */
+    void for_each_pair(Key /* key */, auto&& callable) const { for_each_pair(callable); }
+
+    /**
+     * @brief               Call `callable(value)` for every value whose box overlaps `box`
+     */
+    void for_each_overlapping(const BoundingBox<f64>& box, auto&& callable) const
+    {
+        const auto min       = axis == 0 ? box.min.x : box.min.y;
+        const auto max       = axis == 0 ? box.max.x : box.max.y;
+        const auto cross_min = axis == 0 ? box.min.y : box.min.x;
+        const auto cross_max = axis == 0 ? box.max.y : box.max.x;
+
+        // no interval is longer than max_extent, so none starting earlier can reach min
+        const auto before = [](const Entry& entry, f64 value) { return entry.min < value; };
+        auto iter = std::lower_bound(entries.begin(), entries.end(), min - max_extent, before);
+        for (; iter != entries.end() && iter->min <= max; ++iter)
+        {
+            if (iter->max >= min && iter->cross_min <= cross_max && cross_min <= iter->cross_max)
+            {
+                callable(iter->value);
+            }
+        }
+    }
+
+    /**
+     * @brief               Call `callable(value)` for every value which could touch a value of
+     * the largest size at `pos`
+     */
+    void for_each_neighbor(Vector2 pos, auto&& callable) const
+    {
+        const auto half = Vector2::combine(max_extent / 2.0);
+        for_each_overlapping({pos - half, pos + half}, callable);
+    }
+
+    [[nodiscard]] auto size() const noexcept { return entries.size(); }
+
+    [[nodiscard]] auto empty() const noexcept { return entries.empty(); }
+
+  private:
+    void add(Vector2 pos, f64 radius)
+    {
+        const auto half = Vector2::combine(radius);
+        boxes.push_back({pos - half, pos + half});
+    }
+
+    [[nodiscard]] auto make_entry(u64 value) const noexcept
+    {
+        const auto& box = boxes[value];
+        return axis == 0 ? Entry{box.min.x, box.max.x, box.min.y, box.max.y, static_cast<T>(value)}
+                         : Entry{box.min.y, box.max.y, box.min.x, box.max.x, static_cast<T>(value)};
+    }
+
+    void sort()
+    {
+        const auto count = boxes.size();
+        if (entries.size() != count)
+        {
+            sort_from_scratch();
+            return;
+        }
+
+        max_extent = 0.0;
+        for (auto& entry : entries)
+        {
+            entry      = make_entry(static_cast<u64>(entry.value));
+            max_extent = math::max(max_extent, entry.max - entry.min);
+        }
+
+        // insertion sort is linear for a nearly sorted order. Give up on it if values have moved
+        // too much since the last rebuild
+        const auto max_moves = 32 * count;
+        auto moves           = u64{};
+        for (auto i : loop::start_end(1UL, count))
+        {
+            const auto entry = entries[i];
+            auto j           = i;
+            for (; j > 0 && entries[j - 1].min > entry.min; j--) { entries[j] = entries[j - 1]; }
+            entries[j] = entry;
+
+            moves += i - j;
+            if (moves > max_moves)
+            {
+                sort_from_scratch();
+                return;
+            }
+        }
+    }
+
+    // sweep along the axis the values are spread out most along, which best separates them
+    void sort_from_scratch()
+    {
+        const auto count = boxes.size();
+        auto bounds      = BoundingBox<f64>{};
+        if (count != 0) { bounds = boxes[0]; }
+        for (const auto& box : boxes)
+        {
+            bounds.min = {math::min(bounds.min.x, box.min.x), math::min(bounds.min.y, box.min.y)};
+            bounds.max = {math::max(bounds.max.x, box.max.x), math::max(bounds.max.y, box.max.y)};
+        }
+        axis = bounds.width() >= bounds.height() ? 0UL : 1UL;
+
+        entries.resize(count);
+        max_extent = 0.0;
+        for (auto i : loop::end(count))
+        {
+            entries[i] = make_entry(i);
+            max_extent = math::max(max_extent, entries[i].max - entries[i].min);
+        }
+        std::sort(entries.begin(), entries.end(),
+                  [](const Entry& a, const Entry& b) { return a.min < b.min; });
+    }
+};
+} // namespace sm
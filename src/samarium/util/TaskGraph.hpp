@@ -0,0 +1,185 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <atomic>     // for atomic
+#include <functional> // for function
+#include <string>     // for string
+#include <utility>    // for move
+#include <vector>     // for vector
+
+#include "samarium/core/types.hpp"      // for f64, u32, u64
+#include "samarium/math/loop.hpp"       // for end, start_end
+#include "samarium/util/Error.hpp"      // for Error
+#include "samarium/util/Stopwatch.hpp"  // for Stopwatch
+#include "samarium/util/ThreadPool.hpp" // for ThreadPool
+
+namespace sm
+{
+/**
+ * @brief               Stages of a frame and the order between them, built once and run every
+ * frame. A stage starts as soon as all the stages before it are done, so stages which don't
+ * depend on each other overlap instead of waiting at a barrier between every pair of loops
+ *
+ * Stages may use the same ThreadPool for their own loops. The time each took in the last run is
+ * kept in its node
+ *
+ * @code
+ * auto graph     = TaskGraph{};
+ * const auto a   = graph.add("forces", [&] { ... });
+ * const auto b   = graph.add("walls", [&] { ... });
+ * const auto c   = graph.add("integrate", [&] { ... });
+ * graph.precede(a, c);
+ * graph.precede(b, c);
+ * graph.run(thread_pool); // a and b overlap, then c
+ * @endcode
+ */
+struct TaskGraph
+{
+    struct Node
+    {
+        std::string name;
+        std::function<void()> task;
+        std::vector<u32> successors{};
+        u32 predecessor_count{};
+        f64 seconds{}; // time taken by the last run
+    };
+
+    std::vector<Node> nodes{};
+
+    /**
+     * @brief               Add a stage, which runs `task` once per run()
+     *
+     * @return u32          Index of the node, for precede()
+     */
+    auto add(std::string name, std::function<void()> task) -> u32
+    {
+        nodes.push_back({std::move(name), std::move(task)});
+        prepared = false;
+        return static_cast<u32>(nodes.size() - 1);
+    }
+
+    /**
+     * @brief               Make `after` wait until `before` is done
+     */
+    void precede(u32 before, u32 after)
+    {
+        if (before >= nodes.size() || after >= nodes.size())
+        {
+            throw Error{"TaskGraph: no node with this index"};
+        }
+        nodes[before].successors.push_back(after);
+        nodes[after].predecessor_count++;
+        prepared = false;
+    }
+
+    /**
+     * @brief               Run every stage once on this thread, in an order which respects the
+     * edges
+     */
+    void run()
+    {
+        prepare();
+        for (auto index : order) { run_task(nodes[index]); }
+    }
+
+    /**
+     * @brief               Run every stage once, each as soon as its predecessors are done, and
+     * return once all are done
+     */
+    void run(ThreadPool& thread_pool)
+    {
+        prepare();
+        for (auto i : loop::end(nodes.size()))
+        {
+            remaining[i].store(nodes[i].predecessor_count, std::memory_order_relaxed);
+        }
+
+        thread_pool.parallel_for(
+            0, root_count,
+            [&](u64 min, u64 max)
+            {
+                for (auto i : loop::start_end(min, max)) { run_node(thread_pool, order[i]); }
+            },
+            1);
+    }
+
+    /**
+     * @return f64          Sum of the times of all stages in the last run, which is more than
+     * the time the run took if stages overlapped
+     */
+    [[nodiscard]] auto total_seconds() const noexcept
+    {
+        auto sum = 0.0;
+        for (const auto& node : nodes) { sum += node.seconds; }
+        return sum;
+    }
+
+  private:
+    std::vector<u32> order{}; // topological, starting with the nodes without predecessors
+    u64 root_count{};
+    std::vector<std::atomic<u32>> remaining{}; // predecessors not yet done, during a run
+    bool prepared{};
+
+    static void run_task(Node& node)
+    {
+        const auto watch = Stopwatch{};
+        node.task();
+        node.seconds = watch.seconds();
+    }
+
+    void run_node(ThreadPool& thread_pool, u32 index)
+    {
+        auto& node = nodes[index];
+        run_task(node);
+
+        // the last predecessor to finish starts a node. The pool runs a single one inline
+        thread_pool.parallel_for(
+            0, node.successors.size(),
+            [&](u64 min, u64 max)
+            {
+                for (auto i : loop::start_end(min, max))
+                {
+                    const auto next = node.successors[i];
+                    if (remaining[next].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    {
+                        run_node(thread_pool, next);
+                    }
+                }
+            },
+            1);
+    }
+
+    // sort the nodes topologically once after every change, which also finds cycles
+    void prepare()
+    {
+        if (prepared) { return; }
+
+        order.clear();
+        auto counts = std::vector<u32>(nodes.size());
+        for (auto i : loop::end(nodes.size()))
+        {
+            counts[i] = nodes[i].predecessor_count;
+            if (counts[i] == 0) { order.push_back(static_cast<u32>(i)); }
+        }
+        root_count = order.size();
+
+        for (auto i = 0UL; i < order.size(); i++)
+        {
+            for (auto next : nodes[order[i]].successors)
+            {
+                if (--counts[next] == 0) { order.push_back(next); }
+            }
+        }
+        if (order.size() != nodes.size()) { throw Error{"TaskGraph: the edges form a cycle"}; }
+
+        remaining = std::vector<std::atomic<u32>>(nodes.size());
+        prepared  = true;
+    }
+};
+} // namespace sm
@@ -1,8 +1,344 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
 #pragma once
 
-#include "BS_thread_pool.hpp"
+#include <atomic>             // for atomic
+#include <condition_variable> // for condition_variable
+#include <deque>              // for deque
+#include <exception>          // for exception_ptr, current_exception, rethrow_exception
+#include <mutex>              // for mutex, lock_guard, unique_lock
+#include <optional>           // for optional
+#include <thread>             // for thread, yield
+#include <vector>             // for vector
+
+#include "samarium/core/types.hpp" // for u64
+#include "samarium/math/loop.hpp"  // for end
+#include "samarium/math/math.hpp"  // for min, max
 
 namespace sm
 {
-using ThreadPool = BS::thread_pool;
-}
+struct ThreadPool;
+
+namespace detail
+{
+// the pool and queue of the current thread. Threads outside the pool share its last queue
+struct PoolThread
+{
+    const ThreadPool* pool{};
+    u64 index{};
+};
+
+inline thread_local auto pool_thread = PoolThread{};
+} // namespace detail
+
+/**
+ * @brief               Work-stealing thread pool. Each thread has its own deque of tasks: it
+ * pushes and pops at the back, and idle threads steal from the front of the others
+ *
+ * Loops are split lazily: a thread gives away half of what is left of its range only while it has
+ * nothing queued for others to steal. Uneven work evens out, and even work isn't cut into more
+ * tasks than needed. A thread which waits for a loop or a fork runs tasks meanwhile, so both can
+ * be nested. If a job throws, the rest of its loop is skipped, and the first exception is rethrown
+ * to the caller once no thread is still running the loop
+ */
+struct ThreadPool
+{
+    /**
+     * @param  thread_count Number of threads besides the ones which call into the pool, which take
+     * part too. By default one less than the number of hardware threads
+     */
+    explicit ThreadPool(u64 thread_count = default_thread_count())
+        : queues(math::max(thread_count, 1UL) + 1)
+    {
+        const auto count = math::max(thread_count, 1UL);
+        workers.reserve(count);
+        for (auto i : loop::end(count)) { workers.emplace_back([this, i] { work(i); }); }
+    }
+
+    ThreadPool(const ThreadPool&)                    = delete;
+    auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+    ~ThreadPool()
+    {
+        {
+            const auto lock = std::lock_guard{sleep_mutex};
+            stopping        = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) { worker.join(); }
+    }
+
+    [[nodiscard]] auto get_thread_count() const noexcept { return workers.size(); }
+
+    /**
+     * @brief               Call `job(min, max)` on ranges covering [first, last), using all the
+     * threads, and return once all are done
+     *
+     * @param  first
+     * @param  last
+     * @param  job          Takes 2 u64, and is called from several threads at once
+     * @param  grain        Smallest range given to `job`. 0 picks one from the thread count
+     */
+    template <typename Job> void parallel_for(u64 first, u64 last, Job&& job, u64 grain = 0)
+    {
+        if (first >= last) { return; }
+        if (grain == 0) { grain = math::max((last - first) / (16 * (workers.size() + 1)), 1UL); }
+
+        auto loop_ = Loop<Job>{*this, job, grain};
+        run_range(loop_, first, last);
+        help_until_done(loop_.pending);
+        loop_.failure.rethrow();
+    }
+
+    /**
+     * @brief               Call `first()` and `second()` in parallel, and return once both are
+     * done
+     */
+    template <typename First, typename Second> void fork_join(First&& first, Second&& second)
+    {
+        auto fork = Fork<Second>{*this, second};
+        push({&Fork<Second>::run, &fork, 0, 0});
+        try
+        {
+            first();
+        }
+        catch (...)
+        {
+            fork.failure.capture();
+        }
+        help_until_done(fork.pending);
+        fork.failure.rethrow();
+    }
+
+  private:
+    struct Task
+    {
+        void (*run)(void* context, u64 first, u64 last){};
+        void* context{};
+        u64 first{};
+        u64 last{};
+    };
+
+    struct Queue
+    {
+        std::mutex mutex{};
+        std::deque<Task> tasks{};
+        std::atomic<u64> size{}; // of tasks, to look without locking
+    };
+
+    // the first exception thrown by the jobs of a loop or a fork
+    struct Failure
+    {
+        std::atomic<bool> failed{};
+        std::exception_ptr error{};
+
+        void capture() noexcept
+        {
+            if (!failed.exchange(true, std::memory_order_acq_rel))
+            {
+                error = std::current_exception();
+            }
+        }
+
+        // only once all the jobs are done
+        void rethrow() const
+        {
+            if (error) { std::rethrow_exception(error); }
+        }
+    };
+
+    template <typename Job> struct Loop
+    {
+        ThreadPool& pool;
+        Job& job;
+        u64 grain;
+        std::atomic<u64> pending{}; // ranges given away and not yet done
+        Failure failure{};
+
+        static void run(void* context, u64 first, u64 last)
+        {
+            auto& self = *static_cast<Loop*>(context);
+            auto& pool = self.pool; // self may be gone once pending is 0
+            pool.run_range(self, first, last);
+            self.pending.fetch_sub(1, std::memory_order_release);
+            pool.notify_waiting();
+        }
+    };
+
+    template <typename Callable> struct Fork
+    {
+        ThreadPool& pool;
+        Callable& callable;
+        std::atomic<u64> pending{1};
+        Failure failure{};
+
+        static void run(void* context, u64 /* first */, u64 /* last */)
+        {
+            auto& self = *static_cast<Fork*>(context);
+            try
+            {
+                self.callable();
+            }
+            catch (...)
+            {
+                self.failure.capture();
+            }
+            auto& pool = self.pool; // self may be gone once pending is 0
+            self.pending.fetch_sub(1, std::memory_order_release);
+            pool.notify_waiting();
+        }
+    };
+
+    static constexpr auto spin_count = 64UL; // failed steals before a waiting thread sleeps
+
+    std::vector<Queue> queues;
+    std::vector<std::thread> workers{};
+    std::atomic<u64> queued{}; // tasks in all the queues
+    std::mutex sleep_mutex{};
+    std::condition_variable wake{};
+    bool stopping{};
+
+    [[nodiscard]] auto own_queue() const noexcept
+    {
+        return detail::pool_thread.pool == this ? detail::pool_thread.index : workers.size();
+    }
+
+    template <typename Job> void run_range(Loop<Job>& loop_, u64 first, u64 last)
+    {
+        const auto& queue = queues[own_queue()];
+        while (first < last)
+        {
+            if (loop_.failure.failed.load(std::memory_order_relaxed)) { return; }
+
+            // split while this thread has nothing that others could steal
+            if (last - first > loop_.grain && queue.size.load(std::memory_order_relaxed) == 0)
+            {
+                const auto middle = first + (last - first) / 2;
+                loop_.pending.fetch_add(1, std::memory_order_relaxed);
+                push({&Loop<Job>::run, &loop_, middle, last});
+                last = middle;
+                continue;
+            }
+
+            const auto end = math::min(first + loop_.grain, last);
+            try
+            {
+                loop_.job(first, end);
+            }
+            catch (...)
+            {
+                loop_.failure.capture();
+                return;
+            }
+            first = end;
+        }
+    }
+
+    void push(Task task)
+    {
+        auto& queue = queues[own_queue()];
+        {
+            const auto lock = std::lock_guard{queue.mutex};
+            queue.tasks.push_back(task);
+            queue.size.store(queue.tasks.size(), std::memory_order_relaxed);
+        }
+        queued.fetch_add(1, std::memory_order_release);
+
+        // taking the lock orders this with a worker checking `queued` before it sleeps
+        {
+            const auto lock = std::lock_guard{sleep_mutex};
+        }
+        wake.notify_one();
+    }
+
+    // the newest task of queue `index`, or else the oldest task of another queue
+    [[nodiscard]] auto take(u64 index) -> std::optional<Task>
+    {
+        const auto pop = [&](Queue& queue, bool own) -> std::optional<Task>
+        {
+            if (queue.size.load(std::memory_order_relaxed) == 0) { return std::nullopt; }
+            const auto lock = std::lock_guard{queue.mutex};
+            if (queue.tasks.empty()) { return std::nullopt; }
+
+            const auto task = own ? queue.tasks.back() : queue.tasks.front();
+            if (own) { queue.tasks.pop_back(); }
+            else { queue.tasks.pop_front(); }
+            queue.size.store(queue.tasks.size(), std::memory_order_relaxed);
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return task;
+        };
+
+        if (auto task = pop(queues[index], true)) { return task; }
+        for (auto offset : loop::start_end(1UL, queues.size()))
+        {
+            if (auto task = pop(queues[(index + offset) % queues.size()], false)) { return task; }
+        }
+        return std::nullopt;
+    }
+
+    static void run(const Task& task) { task.run(task.context, task.first, task.last); }
+
+    [[nodiscard]] static auto default_thread_count() -> u64
+    {
+        return math::max(std::thread::hardware_concurrency(), 2U) - 1;
+    }
+
+    // wake threads which wait in help_until_done() for a loop or a fork to finish
+    void notify_waiting()
+    {
+        {
+            const auto lock = std::lock_guard{sleep_mutex};
+        }
+        wake.notify_all();
+    }
+
+    void help_until_done(const std::atomic<u64>& pending)
+    {
+        const auto index = own_queue();
+        auto misses      = 0UL;
+        while (pending.load(std::memory_order_acquire) != 0)
+        {
+            if (const auto task = take(index))
+            {
+                run(*task);
+                misses = 0;
+            }
+            else if (++misses < spin_count) { std::this_thread::yield(); }
+            else
+            {
+                // the rest is running on other threads: sleep until it is done or there is more
+                auto lock = std::unique_lock{sleep_mutex};
+                wake.wait(lock,
+                          [&]
+                          {
+                              return pending.load(std::memory_order_acquire) == 0 ||
+                                     queued.load(std::memory_order_acquire) != 0;
+                          });
+            }
+        }
+    }
+
+    void work(u64 index)
+    {
+        detail::pool_thread = {this, index};
+        while (true)
+        {
+            if (const auto task = take(index))
+            {
+                run(*task);
+                continue;
+            }
+
+            auto lock = std::unique_lock{sleep_mutex};
+            wake.wait(lock,
+                      [this] { return stopping || queued.load(std::memory_order_acquire) != 0; });
+            if (stopping) { return; }
+        }
+    }
+};
+} // namespace sm
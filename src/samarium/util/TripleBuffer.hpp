@@ -0,0 +1,70 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <array>  // for array
+#include <atomic> // for atomic
+
+#include "samarium/core/types.hpp" // for u32
+
+namespace sm
+{
+/**
+ * @brief               Hands the latest of a stream of values from one thread to another without
+ * locks. The writer fills one buffer while the reader holds another, and the third is the latest
+ * one published. Neither side ever waits, and the reader skips values it was too slow to see
+ *
+ * @tparam T            Copied into all 3 buffers at the start, then reused, so that vectors keep
+ * their capacity
+ */
+template <typename T> struct TripleBuffer
+{
+    explicit TripleBuffer(const T& value = T{}) : buffers{value, value, value} {}
+
+    /**
+     * @brief               The buffer to fill before publish(). Writer only
+     */
+    [[nodiscard]] auto write_buffer() noexcept -> T& { return buffers[back]; }
+
+    /**
+     * @brief               Make the write buffer the latest value, and take the oldest buffer to
+     * write to next. Writer only
+     */
+    void publish() noexcept
+    {
+        back = middle.exchange(back | fresh_bit, std::memory_order_acq_rel) & index_mask;
+    }
+
+    /**
+     * @brief               Whether a value was published since the last read()
+     */
+    [[nodiscard]] auto has_new() const noexcept
+    {
+        return (middle.load(std::memory_order_relaxed) & fresh_bit) != 0;
+    }
+
+    /**
+     * @brief               The latest value published, which stays valid until the next call.
+     * Reader only
+     */
+    [[nodiscard]] auto read() noexcept -> const T&
+    {
+        if (has_new()) { front = middle.exchange(front, std::memory_order_acq_rel) & index_mask; }
+        return buffers[front];
+    }
+
+  private:
+    static constexpr auto fresh_bit  = u32{4};
+    static constexpr auto index_mask = u32{3};
+
+    std::array<T, 3> buffers;
+    u32 back{0};                // only used by the writer
+    u32 front{1};               // only used by the reader
+    std::atomic<u32> middle{2}; // index of the latest buffer, and fresh_bit if not yet read
+};
+} // namespace sm
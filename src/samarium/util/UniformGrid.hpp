@@ -0,0 +1,358 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <array>  // for array
+#include <cmath>  // for floor, ceil
+#include <limits> // for numeric_limits
+#include <span>   // for span
+#include <vector> // for vector
+
+#include "samarium/core/types.hpp"       // for f64, i32, u32, u64
+#include "samarium/math/BoundingBox.hpp" // for BoundingBox
+#include "samarium/math/Vector2.hpp"     // for Vector2, Vector2_t
+#include "samarium/math/loop.hpp"        // for end
+#include "samarium/math/math.hpp"        // for min, max
+
+namespace sm
+{
+/**
+ * @brief               Spatial index over a bounded region, rebuilt from scratch with a counting
+ * sort. Values are stored sorted by cell, so every cell and every row of 3 adjacent cells is a
+ * contiguous span: queries neither hash nor copy
+ *
+ * @tparam T            Type of the values stored, usually an index
+ */
+template <typename T = u32> struct UniformGrid
+{
+    using Key = Vector2_t<i32>;
+
+    /**
+     * @brief               The 3x3 cells around a position, flattened into a single range
+     */
+    struct NeighborRange
+    {
+        std::array<std::span<const T>, 3> rows{};
+
+        struct Iterator
+        {
+            const std::array<std::span<const T>, 3>* rows{};
+            u64 row{};
+            u64 index{};
+
+            [[nodiscard]] auto operator*() const noexcept { return (*rows)[row][index]; }
+
+            auto operator++() noexcept -> Iterator&
+            {
+                index++;
+                skip_empty();
+                return *this;
+            }
+
+            auto operator++(int) noexcept -> Iterator
+            {
+                auto tmp = *this;
+                ++(*this);
+                return tmp;
+            }
+
+            void skip_empty() noexcept
+            {
+                while (row < 3 && index == (*rows)[row].size())
+                {
+                    row++;
+                    index = 0;
+                }
+            }
+
+            [[nodiscard]] auto operator==(const Iterator&) const noexcept -> bool = default;
+        };
+
+        [[nodiscard]] auto begin() const noexcept
+        {
+            auto iter = Iterator{&rows, 0UL, 0UL};
+            iter.skip_empty();
+            return iter;
+        }
+
+        [[nodiscard]] auto end() const noexcept { return Iterator{&rows, 3UL, 0UL}; }
+
+        [[nodiscard]] auto size() const noexcept
+        {
+            return rows[0].size() + rows[1].size() + rows[2].size();
+        }
+    };
+
+    BoundingBox<f64> bounds{};
+    f64 spacing;
+    bool fit_to_positions;
+    f64 cell_size{spacing};
+    Dimensions dims{};
+    std::vector<u32> offsets{}; // offsets[i]..offsets[i + 1] is the range of cell i in values
+    std::vector<T> values{};    // values sorted by cell
+    std::vector<u32> cells{};   // cell of each value, scratch space for the sort
+
+    /**
+     * @brief               Make a grid which fits its bounds to the positions on every rebuild
+     *
+     * @param  spacing_     Minimum cell size
+     */
+    explicit UniformGrid(f64 spacing_ = 1.0) : spacing{spacing_}, fit_to_positions{true} {}
+
+    /**
+     * @brief               Make a grid with fixed bounds. Positions outside are clamped to the
+     * border cells
+     *
+     * @param  bounds_      Region covered by the grid
+     * @param  spacing_     Cell size
+     */
+    UniformGrid(const BoundingBox<f64>& bounds_, f64 spacing_)
+        : bounds{bounds_}, spacing{spacing_}, fit_to_positions{false}
+    {
+        resize();
+    }
+
+    [[nodiscard]] auto to_coords(Vector2 pos) const noexcept
+    {
+        const auto x = std::floor((pos.x - bounds.min.x) / cell_size);
+        const auto y = std::floor((pos.y - bounds.min.y) / cell_size);
+        return Key::make(math::min(math::max(x, 0.0), static_cast<f64>(dims.x - 1)),
+                         math::min(math::max(y, 0.0), static_cast<f64>(dims.y - 1)));
+    }
+
+    [[nodiscard]] auto cell_index(Key key) const noexcept
+    {
+        return static_cast<u64>(key.y) * dims.x + static_cast<u64>(key.x);
+    }
+
+    /**
+     * @brief               Replace the contents of the grid with the indices of `positions`
+     *
+     * @param  positions    Sized range of Vector2_t of any floating point type
+     */
+    template <typename Positions> void rebuild(const Positions& positions)
+    {
+        const auto count = static_cast<u64>(positions.size());
+        if (fit_to_positions) { fit(positions, count); }
+
+        const auto cell_count = dims.x * dims.y;
+        offsets.assign(cell_count + 1, 0U);
+        cells.resize(count);
+        values.resize(count);
+
+        // count the values in each cell
+        auto i = u64{};
+        for (const auto& pos : positions)
+        {
+            const auto cell = static_cast<u32>(cell_index(to_coords(static_cast<Vector2>(pos))));
+            cells[i++]      = cell;
+            offsets[cell]++;
+        }
+
+        // exclusive prefix sum: offsets[cell] is where the cell starts
+        auto sum = u32{};
+        for (auto& offset : offsets)
+        {
+            const auto cell_count_ = offset;
+            offset                 = sum;
+            sum += cell_count_;
+        }
+
+        // scatter, which leaves offsets[cell] at the start of the next cell...
+        for (auto j : loop::end(count)) { values[offsets[cells[j]]++] = static_cast<T>(j); }
+
+        // ...so shift back by one
+        for (auto cell = cell_count; cell > 0; cell--) { offsets[cell] = offsets[cell - 1]; }
+        offsets[0] = 0U;
+    }
+
+    [[nodiscard]] auto cell(Key key) const noexcept -> std::span<const T>
+    {
+        if (key.x < 0 || key.y < 0 || static_cast<u64>(key.x) >= dims.x ||
+            static_cast<u64>(key.y) >= dims.y)
+        {
+            return {};
+        }
+        const auto index = cell_index(key);
+        return {values.data() + offsets[index], values.data() + offsets[index + 1]};
+    }
+
+    [[nodiscard]] auto cell_containing(Vector2 pos) const noexcept { return cell(to_coords(pos)); }
+
+    /**
+     * @brief               Call `callable(key, values)` for every non-empty cell
+     */
+    void for_each_cell(auto&& callable) const
+    {
+        for (auto y : loop::end(static_cast<i32>(dims.y)))
+        {
+            for (auto x : loop::end(static_cast<i32>(dims.x)))
+            {
+                const auto key = Key{x, y};
+                if (const auto values_ = cell(key); !values_.empty()) { callable(key, values_); }
+            }
+        }
+    }
+
+    /**
+     * @brief               The 3 rows of 3 cells each around `key`. Cells in a row are adjacent
+     * in memory, so each row is a single span
+     */
+    [[nodiscard]] auto neighbor_cells(Key key) const noexcept
+    {
+        const auto x_min = static_cast<u64>(math::max(key.x - 1, 0));
+        const auto x_max = static_cast<u64>(math::min(key.x + 1, static_cast<i32>(dims.x) - 1));
+
+        auto rows = std::array<std::span<const T>, 3>{};
+        for (auto i : loop::end(3UL))
+        {
+            const auto y = key.y - 1 + static_cast<i32>(i);
+            if (y < 0 || static_cast<u64>(y) >= dims.y) { continue; }
+            const auto row_start = static_cast<u64>(y) * dims.x;
+            rows[i]              = {values.data() + offsets[row_start + x_min],
+                                    values.data() + offsets[row_start + x_max + 1]};
+        }
+        return rows;
+    }
+
+    [[nodiscard]] auto neighbor_cells(Vector2 pos) const noexcept
+    {
+        return neighbor_cells(to_coords(pos));
+    }
+
+    /**
+     * @brief               Call `callable(value)` for every value in the 3x3 cells around `pos`
+     */
+    void for_each_neighbor(Vector2 pos, auto&& callable) const
+    {
+        for (const auto& row : neighbor_cells(pos))
+        {
+            for (auto value : row) { callable(value); }
+        }
+    }
+
+    /**
+     * @brief               Call `callable(value)` for every value in the cells which overlap `box`.
+     * Values outside the bounds are in the border cells, and so are found by boxes past the border
+     */
+    void for_each_overlapping(const BoundingBox<f64>& box, auto&& callable) const
+    {
+        if (offsets.empty()) { return; } // not built yet
+        const auto min = to_coords(box.min);
+        const auto max = to_coords(box.max);
+        for (auto y : loop::start_end(static_cast<u64>(min.y), static_cast<u64>(max.y) + 1))
+        {
+            const auto row_start = y * dims.x;
+            const auto first     = offsets[row_start + static_cast<u64>(min.x)];
+            const auto last      = offsets[row_start + static_cast<u64>(max.x) + 1];
+            for (auto i : loop::start_end(first, last)) { callable(values[i]); }
+        }
+    }
+
+    /**
+     * @brief               The cells after `key` in a half-shell, as 2 spans: (+1, 0), and the row
+     * (-1, +1) to (+1, +1). Every pair of adjacent cells appears exactly once as (cell, forward
+     * neighbour)
+     */
+    [[nodiscard]] auto forward_neighbor_cells(Key key) const noexcept
+    {
+        auto forward = std::array<std::span<const T>, 2>{};
+        if (static_cast<u64>(key.x) + 1 < dims.x) { forward[0] = cell({key.x + 1, key.y}); }
+        if (static_cast<u64>(key.y) + 1 < dims.y)
+        {
+            const auto x_min     = static_cast<u64>(math::max(key.x - 1, 0));
+            const auto x_max     = math::min(static_cast<u64>(key.x) + 1, dims.x - 1);
+            const auto row_start = (static_cast<u64>(key.y) + 1) * dims.x;
+            forward[1]           = {values.data() + offsets[row_start + x_min],
+                                    values.data() + offsets[row_start + x_max + 1]};
+        }
+        return forward;
+    }
+
+    /**
+     * @brief               Call `callable(i, j)` once for every pair owned by the cell `key`: pairs
+     * inside the cell and pairs with its forward neighbours
+     */
+    void for_each_pair(Key key, auto&& callable) const
+    {
+        const auto values_ = cell(key);
+        for (auto a : loop::end(values_.size()))
+        {
+            for (auto b : loop::start_end(a + 1, values_.size()))
+            {
+                callable(values_[a], values_[b]);
+            }
+        }
+
+        for (const auto& neighbor : forward_neighbor_cells(key))
+        {
+            for (auto i : values_)
+            {
+                for (auto j : neighbor) { callable(i, j); }
+            }
+        }
+    }
+
+    /**
+     * @brief               Call `callable(i, j)` once for every pair of values in the same or
+     * adjacent cells
+     */
+    void for_each_pair(auto&& callable) const
+    {
+        for_each_cell([&](Key key, const auto& /* cell */) { for_each_pair(key, callable); });
+    }
+
+    [[nodiscard]] auto neighbors(Vector2 pos) const noexcept
+    {
+        return NeighborRange{neighbor_cells(pos)};
+    }
+
+  private:
+    void resize()
+    {
+        cell_size = spacing;
+        update_dims();
+    }
+
+    void update_dims()
+    {
+        dims = Dimensions::make(math::max(std::ceil(bounds.diagonal().x / cell_size), 1.0),
+                                math::max(std::ceil(bounds.diagonal().y / cell_size), 1.0));
+    }
+
+    template <typename Positions> void fit(const Positions& positions, u64 count)
+    {
+        if (count == 0)
+        {
+            bounds = {};
+            resize();
+            return;
+        }
+
+        auto box = BoundingBox<f64>{Vector2::combine(std::numeric_limits<f64>::max()),
+                                    Vector2::combine(std::numeric_limits<f64>::lowest())};
+        for (const auto& position : positions)
+        {
+            const auto pos = static_cast<Vector2>(position);
+            box.min = {math::min(box.min.x, pos.x), math::min(box.min.y, pos.y)};
+            box.max = {math::max(box.max.x, pos.x), math::max(box.max.y, pos.y)};
+        }
+        bounds = box;
+        resize();
+
+        // a few far away positions shouldn't blow up memory: grow the cells instead, which only
+        // makes queries coarser
+        const auto max_cells = math::max(4UL * count, 1024UL);
+        while (dims.x * dims.y > max_cells)
+        {
+            cell_size *= 2.0;
+            update_dims();
+        }
+    }
+};
+} // namespace sm
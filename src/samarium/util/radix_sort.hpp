@@ -0,0 +1,193 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#pragma once
+
+#include <array>    // for array
+#include <concepts> // for unsigned_integral
+#include <numeric>  // for iota
+#include <span>     // for span
+#include <utility>  // for move
+#include <vector>   // for vector
+
+#include "samarium/core/types.hpp"      // for u32, u64
+#include "samarium/math/loop.hpp"       // for end, start_end
+#include "samarium/math/math.hpp"       // for min, max
+#include "samarium/util/ThreadPool.hpp" // for ThreadPool
+
+namespace sm::util
+{
+namespace detail
+{
+using Histogram = std::array<u32, 256>;
+
+template <std::unsigned_integral Key>
+[[nodiscard]] constexpr auto digit_of(Key key, u64 pass) noexcept -> u64
+{
+    return static_cast<u64>(key >> (8U * pass)) & 0xFFU;
+}
+
+// passes over which all keys have the same digit don't reorder anything
+template <std::unsigned_integral Key>
+[[nodiscard]] auto varying_passes(std::span<const Key> keys) -> std::vector<u64>
+{
+    auto all_or  = Key{};
+    auto all_and = static_cast<Key>(~Key{});
+    for (auto key : keys)
+    {
+        all_or |= key;
+        all_and &= key;
+    }
+
+    auto passes = std::vector<u64>{};
+    for (auto pass : loop::end(sizeof(Key)))
+    {
+        if (digit_of(static_cast<Key>(all_or ^ all_and), pass) != 0) { passes.push_back(pass); }
+    }
+    return passes;
+}
+} // namespace detail
+
+/**
+ * @brief               Stable least significant digit radix sort, 8 bits at a time
+ *
+ * @param  keys
+ * @return std::vector<u32> Indices of the keys in sorted order: keys[order[0]] is the smallest
+ */
+template <std::unsigned_integral Key>
+[[nodiscard]] auto radix_sort(std::span<const Key> keys) -> std::vector<u32>
+{
+    if (keys.empty()) { return {}; }
+
+    auto order = std::vector<u32>(keys.size());
+    std::iota(order.begin(), order.end(), 0U);
+    auto scratch = std::vector<u32>(keys.size());
+
+    for (auto pass : detail::varying_passes(keys))
+    {
+        auto offsets = detail::Histogram{};
+        for (auto key : keys) { offsets[detail::digit_of(key, pass)]++; }
+
+        auto sum = u32{};
+        for (auto& offset : offsets)
+        {
+            const auto count = offset;
+            offset           = sum;
+            sum += count;
+        }
+
+        for (auto index : order)
+        {
+            scratch[offsets[detail::digit_of(keys[index], pass)]++] = index;
+        }
+        order.swap(scratch);
+    }
+    return order;
+}
+
+/**
+ * @brief               Stable least significant digit radix sort, 8 bits at a time. Each thread
+ * counts and then scatters its own block of keys, into slots reserved for it after the blocks
+ * before it, so the result is the same as the single threaded sort
+ *
+ * @param  keys
+ * @param  thread_pool
+ * @return std::vector<u32> Indices of the keys in sorted order: keys[order[0]] is the smallest
+ */
+template <std::unsigned_integral Key>
+[[nodiscard]] auto radix_sort(std::span<const Key> keys, ThreadPool& thread_pool)
+    -> std::vector<u32>
+{
+    if (keys.empty()) { return {}; }
+
+    const auto size        = keys.size();
+    const auto threads     = math::max(static_cast<u64>(thread_pool.get_thread_count()), 1UL);
+    const auto block_size  = (size + threads - 1) / threads;
+    const auto block_count = (size + block_size - 1) / block_size;
+
+    auto order = std::vector<u32>(size);
+    std::iota(order.begin(), order.end(), 0U);
+    auto scratch    = std::vector<u32>(size);
+    auto histograms = std::vector<detail::Histogram>(block_count);
+
+    const auto for_each_block = [&](auto&& job)
+    {
+        thread_pool.parallel_for(
+            0UL, block_count,
+            [&](u64 min, u64 max)
+            {
+                for (auto block : loop::start_end(min, max))
+                {
+                    job(block, block * block_size, math::min((block + 1) * block_size, size));
+                }
+            },
+            1UL);
+    };
+
+    for (auto pass : detail::varying_passes(keys))
+    {
+        for_each_block(
+            [&](u64 block, u64 first, u64 last)
+            {
+                auto& histogram = histograms[block];
+                histogram.fill(0U);
+                for (auto i : loop::start_end(first, last))
+                {
+                    histogram[detail::digit_of(keys[order[i]], pass)]++;
+                }
+            });
+
+        // digit by digit, then block by block: where each block writes each digit
+        auto sum = u32{};
+        for (auto digit : loop::end(256UL))
+        {
+            for (auto& histogram : histograms)
+            {
+                const auto count = histogram[digit];
+                histogram[digit] = sum;
+                sum += count;
+            }
+        }
+
+        for_each_block(
+            [&](u64 block, u64 first, u64 last)
+            {
+                auto& offsets = histograms[block];
+                for (auto i : loop::start_end(first, last))
+                {
+                    scratch[offsets[detail::digit_of(keys[order[i]], pass)]++] = order[i];
+                }
+            });
+        order.swap(scratch);
+    }
+    return order;
+}
+
+/**
+ * @brief               Inverse of a permutation: if order[i] == j, then inverse[j] == i
+ */
+[[nodiscard]] inline auto invert_permutation(std::span<const u32> order) -> std::vector<u32>
+{
+    auto inverse = std::vector<u32>(order.size());
+    for (auto i : loop::end(order.size())) { inverse[order[i]] = static_cast<u32>(i); }
+    return inverse;
+}
+
+/**
+ * @brief               Move values[i] to values[new_index[i]], for per-particle data kept outside
+ * a ParticleSystem
+ *
+ * @param  values
+ * @param  new_index    Where each value moves to, as returned by ParticleSystem::reorder()
+ */
+template <typename T> void permute(std::vector<T>& values, std::span<const u32> new_index)
+{
+    auto output = std::vector<T>(values.size());
+    for (auto i : loop::end(values.size())) { output[new_index[i]] = std::move(values[i]); }
+    values.swap(output);
+}
+} // namespace sm::util
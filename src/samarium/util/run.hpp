@@ -7,10 +7,18 @@
 
 #pragma once
 
-#include <concepts>
+#include <atomic>     // for atomic
+#include <chrono>     // for steady_clock, duration
+#include <cmath>      // for fmod
+#include <concepts>   // for invocable
+#include <exception>  // for exception_ptr, current_exception, rethrow_exception
+#include <stop_token> // for stop_token
+#include <thread>     // for jthread, sleep_until
 
 #include "samarium/gui/Window.hpp"
+#include "samarium/math/math.hpp"
 #include "samarium/util/Stopwatch.hpp"
+#include "samarium/util/TripleBuffer.hpp"
 
 namespace sm
 {
@@ -43,20 +51,180 @@ auto run(Window& window,
          const std::invocable auto& draw,
          u64 substeps = 1)
 {
-    auto watch = Stopwatch{};
     while (window.is_open())
     {
-        for (auto i : loop::end(substeps))
+        for ([[maybe_unused]] auto i : loop::end(substeps)) { update(); }
+        draw();
+
+        window.display();
+    }
+}
+
+/**
+ * @brief               Settings of the fixed timestep overload of run()
+ */
+struct FixedTimestep
+{
+    f64 timestep  = 1.0 / 60.0; // in seconds
+    u64 max_steps = 8;          // per frame, after which the simulation falls behind real time
+};
+
+/**
+ * @brief               Step the simulation by a fixed timestep as many times as the time since the
+ * last frame calls for, then draw. The simulation keeps to real time however fast frames are
+ *
+ * At most `max_steps` steps are taken per frame, and the rest of the time is dropped: when a step
+ * takes longer than `timestep`, the simulation slows down instead of falling further behind every
+ * frame
+ *
+ * @param  window       Window to display
+ * @param  update       Called as `update(timestep)`
+ * @param  draw         Called as `draw(alpha)`, where alpha in [0, 1) is how far the time is into
+ * the next step, to interpolate between the last 2 states
+ * @param  fixed        Timestep and the most steps per frame
+ */
+auto run(Window& window,
+         const std::invocable<f64> auto& update,
+         const std::invocable<f64> auto& draw,
+         FixedTimestep fixed)
+{
+    auto watch       = Stopwatch{};
+    auto accumulator = 0.0;
+    while (window.is_open())
+    {
+        accumulator += watch.seconds();
+        watch.reset();
+
+        auto steps = 0UL;
+        while (accumulator >= fixed.timestep && steps < fixed.max_steps)
         {
-            update();
-            watch.reset();
+            update(fixed.timestep);
+            accumulator -= fixed.timestep;
+            steps++;
         }
-        draw();
+        if (accumulator >= fixed.timestep) { accumulator = std::fmod(accumulator, fixed.timestep); }
 
+        draw(accumulator / fixed.timestep);
         window.display();
     }
 }
 
+/**
+ * @brief               Rates measured by run_async(), updated about once a second
+ */
+struct AsyncRunStats
+{
+    f64 sim_rate{};    // steps per second
+    f64 render_rate{}; // frames per second
+    u64 steps{};       // steps so far
+    u64 frames{};      // frames so far
+};
+
+namespace detail
+{
+template <typename State> struct Snapshot
+{
+    State previous;
+    State current;
+    std::chrono::steady_clock::time_point time{}; // when current was published
+};
+} // namespace detail
+
+/**
+ * @brief               Run the simulation on a thread of its own at a fixed timestep, and draw on
+ * this thread as often as the window displays. Neither throttles the other: each step publishes
+ * a snapshot into a TripleBuffer, and each frame draws the latest one without locking
+ *
+ * Frames are drawn one step behind, interpolating between the last 2 states, so motion stays
+ * smooth when the frame rate and the step rate differ. If a step takes longer than `timestep`,
+ * the simulation slows down, and after a stall it carries on from the current time instead of
+ * catching up
+ *
+ * @param  window       Window to display
+ * @param  state        Initial state of the simulation, which is then owned by its thread
+ * @param  update       Called as `update(state, timestep)` on the simulation thread, so it must
+ * not use the window
+ * @param  draw         Called as `draw(previous, current, alpha)`, where alpha in [0, 1] is how
+ * far to interpolate from previous to current
+ * @param  stats        Updated on this thread, so draw may show it
+ * @param  timestep     In seconds
+ */
+template <typename State>
+void run_async(Window& window,
+               State state,
+               auto&& update,
+               auto&& draw,
+               AsyncRunStats& stats,
+               f64 timestep = 1.0 / 60.0)
+{
+    using Clock     = std::chrono::steady_clock;
+    const auto step = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<f64>{timestep});
+
+    auto buffer = TripleBuffer<detail::Snapshot<State>>{{state, state, Clock::now()}};
+    auto steps  = std::atomic<u64>{stats.steps};
+    auto failed = std::atomic<bool>{};
+    auto error  = std::exception_ptr{};
+
+    // declared after what it refers to, so that on every way out, including exceptions from draw,
+    // it is stopped and joined before those are destroyed
+    auto simulation = std::jthread(
+        [&](std::stop_token stop)
+        {
+            try
+            {
+                auto next = Clock::now();
+                while (!stop.stop_requested())
+                {
+                    std::this_thread::sleep_until(next);
+
+                    auto& snapshot    = buffer.write_buffer();
+                    snapshot.previous = state;
+                    update(state, timestep);
+                    snapshot.current = state;
+                    snapshot.time    = Clock::now();
+                    buffer.publish();
+                    steps.fetch_add(1, std::memory_order_relaxed);
+
+                    next += step;
+                    if (snapshot.time - next > 8 * step) { next = snapshot.time; }
+                }
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+                failed.store(true, std::memory_order_release);
+            }
+        });
+
+    auto watch       = Stopwatch{};
+    auto last_steps  = stats.steps;
+    auto last_frames = stats.frames;
+    while (window.is_open() && !failed.load(std::memory_order_acquire))
+    {
+        const auto& snapshot = buffer.read();
+        const auto behind    = std::chrono::duration<f64>{Clock::now() - snapshot.time}.count();
+        draw(snapshot.previous, snapshot.current, math::min(behind / timestep, 1.0));
+        window.display();
+
+        stats.frames++;
+        stats.steps         = steps.load(std::memory_order_relaxed);
+        const auto interval = watch.seconds();
+        if (interval >= 1.0)
+        {
+            stats.sim_rate    = static_cast<f64>(stats.steps - last_steps) / interval;
+            stats.render_rate = static_cast<f64>(stats.frames - last_frames) / interval;
+            last_steps        = stats.steps;
+            last_frames       = stats.frames;
+            watch.reset();
+        }
+    }
+
+    simulation.request_stop();
+    simulation.join();
+    if (error) { std::rethrow_exception(error); }
+}
+
 auto zoom_pan(Window& window, f64 zoom_factor = 0.1, f64 pan_factor = 1.0)
 {
     if (window.mouse.left)
@@ -0,0 +1,141 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#include <cmath>  // for sqrt
+#include <vector> // for vector
+
+#include "samarium/math/BoundingBox.hpp"
+#include "samarium/math/math.hpp"
+#include "samarium/physics/BarnesHut.hpp"
+#include "samarium/physics/ParticleSystem.hpp"
+#include "samarium/util/RandomGenerator.hpp"
+#include "samarium/util/ThreadPool.hpp"
+
+#include "catch2/catch_test_macros.hpp"
+
+using namespace sm;
+
+constexpr auto body_count = 2000UL;
+
+// bodies of different masses scattered over a square
+static auto make_bodies()
+{
+    auto rand   = RandomGenerator{body_count};
+    auto system = ParticleSystem<>{body_count};
+    for (auto& particle : system)
+    {
+        particle.pos  = rand.vector(BoundingBox<f64>::square(50.0));
+        particle.mass = rand.range<f64>({0.5, 2.0});
+    }
+    return system;
+}
+
+static auto brute_force(const ParticleSystem<>& system)
+{
+    auto accelerations = std::vector<Vector2>(system.size());
+    for (auto i : loop::end(system.size()))
+    {
+        for (auto j : loop::end(system.size()))
+        {
+            if (i == j) { continue; }
+            const auto vec         = system.particles[j].pos - system.particles[i].pos;
+            const auto distance_sq = vec.length_sq();
+            accelerations[i] +=
+                vec * (system.particles[j].mass / (distance_sq * std::sqrt(distance_sq)));
+        }
+    }
+    return accelerations;
+}
+
+// root mean square error relative to the root mean square of the exact accelerations
+static auto relative_error(const ParticleSystem<>& system, const std::vector<Vector2>& exact)
+{
+    auto error = 0.0;
+    auto total = 0.0;
+    for (auto i : loop::end(system.size()))
+    {
+        error += (system.particles[i].acc - exact[i]).length_sq();
+        total += exact[i].length_sq();
+    }
+    return std::sqrt(error / total);
+}
+
+TEST_CASE("phys::apply_long_range_forces matches brute force")
+{
+    auto system      = make_bodies();
+    const auto exact = brute_force(system);
+    auto thread_pool = ThreadPool{4};
+    const auto error = [&](f64 theta, bool threaded)
+    {
+        for (auto& particle : system) { particle.acc = Vector2{}; }
+        if (threaded) { phys::apply_long_range_forces(system, 1.0, theta, thread_pool); }
+        else { phys::apply_long_range_forces(system, 1.0, theta); }
+        return relative_error(system, exact);
+    };
+
+    SECTION("exactly with an opening angle of 0")
+    {
+        REQUIRE(error(0.0, false) < 1e-12);
+        REQUIRE(error(0.0, true) < 1e-12);
+    }
+
+    SECTION("closely with a typical opening angle")
+    {
+        REQUIRE(error(0.5, false) < 1e-2);
+        REQUIRE(error(0.5, true) < 1e-2);
+    }
+
+    SECTION("more closely with smaller opening angles")
+    {
+        REQUIRE(error(0.3, true) < error(0.6, true));
+        REQUIRE(error(0.6, true) < error(1.0, true));
+    }
+}
+
+TEST_CASE("BarnesHut builds the same tree with and without threads")
+{
+    const auto system = make_bodies();
+    auto thread_pool  = ThreadPool{4};
+    auto serial       = BarnesHut<f64>{};
+    auto threaded     = BarnesHut<f64>{};
+    serial.rebuild(system.particles);
+    threaded.rebuild(system.particles, thread_pool);
+
+    // the threaded build always splits the top levels, so it may have a few more nodes
+    REQUIRE(serial.order == threaded.order);
+    REQUIRE(threaded.nodes.size() >= serial.nodes.size());
+    REQUIRE(math::abs(threaded.nodes[0].mass - serial.nodes[0].mass) < 1e-9);
+    REQUIRE((threaded.nodes[0].centre_of_mass - serial.nodes[0].centre_of_mass).length() < 1e-9);
+}
+
+TEST_CASE("BarnesHut handles particles which all share one position")
+{
+    auto thread_pool = ThreadPool{4};
+    const auto check = [&](u64 count)
+    {
+        auto system = ParticleSystem<>{count};
+        for (auto& particle : system) { particle.pos = Vector2{3.0, -2.0}; }
+
+        for (auto threaded : {false, true})
+        {
+            auto tree = BarnesHut<f64>{};
+            if (threaded) { tree.rebuild(system.particles, thread_pool); }
+            else { tree.rebuild(system.particles); }
+
+            REQUIRE(math::abs(tree.nodes[0].mass - static_cast<f64>(count)) < 1e-9);
+            REQUIRE((tree.nodes[0].centre_of_mass - Vector2{3.0, -2.0}).length() < 1e-9);
+            for (auto i : loop::end(count))
+            {
+                // coincident bodies don't pull each other
+                REQUIRE(tree.acceleration(i, 0.5) == Vector2{});
+            }
+        }
+    };
+
+    SECTION("a single particle") { check(1); }
+    SECTION("many coincident particles") { check(100); }
+}
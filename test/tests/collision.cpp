@@ -0,0 +1,119 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#include <vector> // for vector
+
+#include "samarium/physics/collision.hpp"
+#include "samarium/util/RandomGenerator.hpp"
+
+#include "catch2/catch_test_macros.hpp"
+
+using namespace sm;
+
+// the original rotation based collision, which resolves along the x axis of a rotated frame
+static auto reference_collide(Particle<f64>& p1, Particle<f64>& p2, f64 damping) -> bool
+{
+    if (!phys::did_collide(p1, p2)) { return false; }
+
+    const auto angle_of_impact = Vector2::angle_between(p1.pos, p2.pos);
+    const auto swap_left_right =
+        p1.pos.rotated(-angle_of_impact).x > p2.pos.rotated(-angle_of_impact).x;
+
+    p1.vel.rotate(-angle_of_impact);
+    p2.vel.rotate(-angle_of_impact);
+    if (swap_left_right) { std::swap(p1, p2); }
+
+    const auto did_collide = p2.vel.x <= p1.vel.x;
+    if (did_collide)
+    {
+        const auto delta = damping * (p1.vel.x - p2.vel.x);
+        p1.vel.x = (p1.mass * p1.vel.x + p2.mass * p2.vel.x - delta) / (p1.mass + p2.mass);
+        p2.vel.x = p1.vel.x + delta;
+    }
+
+    if (swap_left_right) { std::swap(p1, p2); }
+    p1.vel.rotate(angle_of_impact);
+    p2.vel.rotate(angle_of_impact);
+    return did_collide;
+}
+
+static auto almost_equal(Vector2 a, Vector2 b) { return math::distance(a, b) < 1e-9; }
+
+static auto random_particle(RandomGenerator& rand, f64 width)
+{
+    return Particle<f64>{.pos    = rand.vector({{-width, -width}, {width, width}}),
+                         .vel    = rand.polar_vector({0.0, 4.0}),
+                         .radius = rand.range<f64>({0.2, 1.0}),
+                         .mass   = rand.range<f64>({0.5, 4.0})};
+}
+
+TEST_CASE("phys::collide matches rotation based collision")
+{
+    auto rand = RandomGenerator{};
+
+    // the reference uses the angle of the position vectors, which is the line of centres when the
+    // first particle is at the origin
+    for (auto i = 0; i < 10'000; i++)
+    {
+        auto p1         = random_particle(rand, 1.5);
+        auto p2         = random_particle(rand, 1.5);
+        const auto damp = rand.range<f64>({0.5, 1.0});
+        p2.pos -= p1.pos;
+        p1.pos = {};
+
+        auto q1 = p1;
+        auto q2 = p2;
+
+        REQUIRE(phys::collide(p1, p2, damp) == reference_collide(q1, q2, damp));
+        REQUIRE(almost_equal(p1.vel, q1.vel));
+        REQUIRE(almost_equal(p2.vel, q2.vel));
+    }
+}
+
+TEST_CASE("phys::collide conserves momentum for equal masses")
+{
+    auto p1 = Particle<f64>{.pos = {0.0, 0.0}, .vel = {1.0, 0.5}};
+    auto p2 = Particle<f64>{.pos = {1.5, 0.5}, .vel = {-1.0, 0.0}};
+
+    const auto before = p1.vel + p2.vel;
+    REQUIRE(phys::collide(p1, p2));
+    REQUIRE(almost_equal(p1.vel + p2.vel, before));
+
+    // now moving apart
+    REQUIRE(!phys::collide(p1, p2));
+}
+
+TEST_CASE("phys::collide over pairs matches colliding one pair at a time")
+{
+    auto rand          = RandomGenerator{};
+    auto particles     = std::vector<Particle<f64>>(200);
+    auto pairs         = std::vector<phys::IndexPair>{};
+    const auto damping = 0.9;
+
+    for (auto& particle : particles) { particle = random_particle(rand, 6.0); }
+    // ordered by offset so that consecutive pairs rarely share a particle
+    for (auto offset = 1U; offset < particles.size(); offset++)
+    {
+        for (auto i = 0U; i + offset < particles.size(); i++) { pairs.push_back({i, i + offset}); }
+    }
+
+    auto expected       = particles;
+    auto expected_count = u64{};
+    for (const auto& [i, j] : pairs)
+    {
+        expected_count += phys::collide(expected[i], expected[j], damping);
+    }
+
+    const auto count = phys::collide(std::span{particles}, std::span{pairs}, damping);
+
+    REQUIRE(count == expected_count);
+    REQUIRE(count > 0);
+    for (auto i = 0U; i < particles.size(); i++)
+    {
+        REQUIRE(almost_equal(particles[i].vel, expected[i].vel));
+    }
+}
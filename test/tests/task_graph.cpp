@@ -0,0 +1,120 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#include <array>  // for array
+#include <atomic> // for atomic
+#include <chrono> // for milliseconds
+#include <thread> // for sleep_for
+
+#include "samarium/core/types.hpp"
+#include "samarium/math/loop.hpp"
+#include "samarium/util/Error.hpp"
+#include "samarium/util/TaskGraph.hpp"
+#include "samarium/util/ThreadPool.hpp"
+
+#include "catch2/catch_test_macros.hpp"
+
+using namespace sm;
+
+TEST_CASE("TaskGraph runs each node after all its predecessors")
+{
+    auto thread_pool = ThreadPool{4};
+
+    // a diamond a -> {b, c} -> d, and e -> d
+    auto graph      = TaskGraph{};
+    auto clock      = std::atomic<u32>{};
+    auto finished   = std::array<u32, 5>{};
+    auto started    = std::array<u32, 5>{};
+    const auto node = [&](u32 index)
+    {
+        return [&, index]
+        {
+            started[index] = clock++;
+            std::this_thread::yield();
+            finished[index] = clock++;
+        };
+    };
+    const auto a = graph.add("a", node(0));
+    const auto b = graph.add("b", node(1));
+    const auto c = graph.add("c", node(2));
+    const auto d = graph.add("d", node(3));
+    const auto e = graph.add("e", node(4));
+    graph.precede(a, b);
+    graph.precede(a, c);
+    graph.precede(b, d);
+    graph.precede(c, d);
+    graph.precede(e, d);
+
+    const auto check = [&]
+    {
+        REQUIRE(finished[a] < started[b]);
+        REQUIRE(finished[a] < started[c]);
+        REQUIRE(finished[b] < started[d]);
+        REQUIRE(finished[c] < started[d]);
+        REQUIRE(finished[e] < started[d]);
+    };
+
+    SECTION("with a thread pool")
+    {
+        for ([[maybe_unused]] auto i : loop::end(200))
+        {
+            graph.run(thread_pool);
+            check();
+        }
+    }
+
+    SECTION("on this thread")
+    {
+        graph.run();
+        check();
+    }
+}
+
+TEST_CASE("TaskGraph throws on a cycle")
+{
+    auto graph   = TaskGraph{};
+    const auto a = graph.add("a", [] {});
+    const auto b = graph.add("b", [] {});
+    const auto c = graph.add("c", [] {});
+    graph.precede(a, b);
+    graph.precede(b, c);
+    graph.precede(c, b);
+
+    auto thread_pool = ThreadPool{1};
+    REQUIRE_THROWS_AS(graph.run(), Error);
+    REQUIRE_THROWS_AS(graph.run(thread_pool), Error);
+    REQUIRE_THROWS_AS(graph.precede(a, 3), Error);
+}
+
+TEST_CASE("TaskGraph runs a node once despite duplicate edges")
+{
+    auto graph   = TaskGraph{};
+    auto counts  = std::array<std::atomic<u32>, 2>{};
+    const auto a = graph.add("a", [&] { counts[0]++; });
+    const auto b = graph.add("b", [&] { counts[1]++; });
+    graph.precede(a, b);
+    graph.precede(a, b);
+
+    auto thread_pool = ThreadPool{4};
+    graph.run(thread_pool);
+    graph.run();
+    REQUIRE(counts[0] == 2);
+    REQUIRE(counts[1] == 2);
+}
+
+TEST_CASE("TaskGraph times each node")
+{
+    auto graph = TaskGraph{};
+    graph.add("sleep", [] { std::this_thread::sleep_for(std::chrono::milliseconds(5)); });
+    graph.add("nothing", [] {});
+
+    auto thread_pool = ThreadPool{2};
+    graph.run(thread_pool);
+    REQUIRE(graph.nodes[0].seconds >= 0.005);
+    REQUIRE(graph.nodes[1].seconds < graph.nodes[0].seconds);
+    REQUIRE(graph.total_seconds() >= graph.nodes[0].seconds);
+}
@@ -0,0 +1,163 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#include <atomic>    // for atomic
+#include <stdexcept> // for runtime_error
+#include <thread>    // for thread
+#include <utility>   // for pair
+#include <vector>    // for vector
+
+#include "samarium/core/types.hpp"
+#include "samarium/math/loop.hpp"
+#include "samarium/util/ThreadPool.hpp"
+
+#include "catch2/catch_test_macros.hpp"
+
+using namespace sm;
+
+// recursive fork_join down to small sizes
+static auto fibonacci(ThreadPool& thread_pool, u64 n) -> u64
+{
+    if (n < 2) { return n; }
+    if (n < 12) { return fibonacci(thread_pool, n - 1) + fibonacci(thread_pool, n - 2); }
+
+    auto a = u64{};
+    auto b = u64{};
+    thread_pool.fork_join([&] { a = fibonacci(thread_pool, n - 1); },
+                          [&] { b = fibonacci(thread_pool, n - 2); });
+    return a + b;
+}
+
+TEST_CASE("ThreadPool::parallel_for covers each index exactly once")
+{
+    for (auto thread_count : {1UL, 3UL, 8UL})
+    {
+        auto thread_pool = ThreadPool{thread_count};
+        REQUIRE(thread_pool.get_thread_count() == thread_count);
+
+        for (auto grain : {0UL, 1UL, 64UL})
+        {
+            auto hits = std::vector<u64>(10'007);
+            thread_pool.parallel_for(
+                0UL, hits.size(),
+                [&](u64 min, u64 max)
+                {
+                    for (auto i : loop::start_end(min, max)) { hits[i]++; }
+                },
+                grain);
+            auto wrong = 0UL;
+            for (auto hit : hits) { wrong += hit != 1 ? 1UL : 0UL; }
+            REQUIRE(wrong == 0);
+        }
+    }
+}
+
+TEST_CASE("ThreadPool::parallel_for with empty and small ranges")
+{
+    auto thread_pool = ThreadPool{1};
+
+    SECTION("an empty or reversed range calls nothing")
+    {
+        auto calls = 0UL;
+        thread_pool.parallel_for(5UL, 5UL, [&](u64, u64) { calls++; });
+        thread_pool.parallel_for(7UL, 3UL, [&](u64, u64) { calls++; });
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("a grain larger than the range gives one call with all of it")
+    {
+        auto ranges = std::vector<std::pair<u64, u64>>{};
+        thread_pool.parallel_for(
+            10UL, 20UL, [&](u64 min, u64 max) { ranges.emplace_back(min, max); }, 1000);
+        REQUIRE(ranges.size() == 1);
+        REQUIRE(ranges[0] == std::pair{10UL, 20UL});
+    }
+}
+
+TEST_CASE("ThreadPool nests loops and forks")
+{
+    for (auto thread_count : {1UL, 3UL, 8UL})
+    {
+        auto thread_pool = ThreadPool{thread_count};
+
+        // parallel_for inside parallel_for
+        auto sum = std::atomic<u64>{};
+        thread_pool.parallel_for(
+            0UL, 100UL,
+            [&](u64 min, u64 max)
+            {
+                for ([[maybe_unused]] auto i : loop::start_end(min, max))
+                {
+                    thread_pool.parallel_for(
+                        0UL, 100UL, [&](u64 first, u64 last) { sum += last - first; }, 7);
+                }
+            },
+            1);
+        REQUIRE(sum == 10'000);
+
+        REQUIRE(fibonacci(thread_pool, 25) == 75'025);
+    }
+}
+
+TEST_CASE("ThreadPool takes loops from several outside threads at once")
+{
+    for (auto thread_count : {1UL, 3UL, 8UL})
+    {
+        auto thread_pool = ThreadPool{thread_count};
+        auto total       = std::atomic<u64>{};
+        auto callers     = std::vector<std::thread>{};
+        for ([[maybe_unused]] auto i : loop::end(4))
+        {
+            callers.emplace_back(
+                [&]
+                {
+                    for ([[maybe_unused]] auto j : loop::end(50))
+                    {
+                        thread_pool.parallel_for(0UL, 1000UL,
+                                                 [&](u64 min, u64 max) { total += max - min; });
+                    }
+                });
+        }
+        for (auto& caller : callers) { caller.join(); }
+        REQUIRE(total == 4 * 50 * 1000);
+    }
+}
+
+TEST_CASE("ThreadPool rethrows exceptions from jobs to the caller")
+{
+    auto thread_pool = ThreadPool{3};
+
+    SECTION("from parallel_for")
+    {
+        const auto loop_ = [&]
+        {
+            thread_pool.parallel_for(
+                0UL, 1000UL,
+                [&](u64 min, u64 max)
+                {
+                    if (min <= 500 && 500 < max) { throw std::runtime_error{"job"}; }
+                },
+                1);
+        };
+        REQUIRE_THROWS_AS(loop_(), std::runtime_error);
+    }
+
+    SECTION("from either side of fork_join")
+    {
+        const auto fail = [] { throw std::runtime_error{"fork"}; };
+        const auto pass = [] {};
+        REQUIRE_THROWS_AS(thread_pool.fork_join(fail, pass), std::runtime_error);
+        REQUIRE_THROWS_AS(thread_pool.fork_join(pass, fail), std::runtime_error);
+    }
+
+    SECTION("and keeps working afterwards")
+    {
+        REQUIRE_THROWS(thread_pool.parallel_for(0UL, 10UL, [](u64, u64)
+                                                { throw std::runtime_error{"job"}; }));
+        REQUIRE(fibonacci(thread_pool, 20) == 6765);
+    }
+}
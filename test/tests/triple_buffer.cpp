@@ -0,0 +1,64 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#include <thread> // for thread
+
+#include "samarium/core/types.hpp"
+#include "samarium/util/TripleBuffer.hpp"
+
+#include "catch2/catch_test_macros.hpp"
+
+using namespace sm;
+
+TEST_CASE("TripleBuffer hands over the latest value")
+{
+    auto buffer = TripleBuffer<u64>{7};
+    REQUIRE(!buffer.has_new());
+    REQUIRE(buffer.read() == 7);
+
+    buffer.write_buffer() = 1;
+    buffer.publish();
+    buffer.write_buffer() = 2;
+    buffer.publish();
+    REQUIRE(buffer.has_new());
+    REQUIRE(buffer.read() == 2);
+    REQUIRE(!buffer.has_new());
+    REQUIRE(buffer.read() == 2);
+}
+
+TEST_CASE("TripleBuffer never goes back in time across threads")
+{
+    struct Pair
+    {
+        u64 first{};
+        u64 second{};
+    };
+
+    constexpr auto count = 200'000UL;
+    auto buffer          = TripleBuffer<Pair>{};
+
+    auto writer = std::thread(
+        [&]
+        {
+            for (auto i = 1UL; i <= count; i++)
+            {
+                buffer.write_buffer() = {i, i};
+                buffer.publish();
+            }
+        });
+
+    auto last = 0UL;
+    auto torn = false;
+    while (last < count)
+    {
+        const auto& value = buffer.read();
+        if (value.first != value.second || value.first < last) { torn = true; }
+        last = value.first;
+    }
+    writer.join();
+    REQUIRE(!torn);
+}
@@ -0,0 +1,99 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) 2022 Jai Bellare
+ * See <https://opensource.org/licenses/MIT/> or LICENSE.md
+ * Project homepage: https://github.com/strangeQuark1041/samarium
+ */
+
+#include <cmath>   // for isfinite
+#include <limits>  // for numeric_limits
+#include <utility> // for pair
+
+#include "samarium/physics/ParticleSystem.hpp"
+#include "samarium/physics/SpringSystem.hpp"
+#include "samarium/physics/XPBD.hpp"
+#include "samarium/physics/integrators.hpp"
+
+#include "catch2/catch_test_macros.hpp"
+
+using namespace sm;
+
+using Rope = ParticleSystem<Particle<f64>, 32, HashGrid<u32, 32>, phys::PositionVerlet<f64>>;
+
+constexpr auto link_count = 20UL;
+constexpr auto stiffness  = 1e6;
+constexpr auto frame_time = 1.0 / 60.0;
+
+// a horizontal rope of very stiff springs, pinned at one end, which falls and swings under gravity.
+// Its particles have unit mass, so the force of gravity is its acceleration
+static auto make_rope()
+{
+    auto rope = Rope{link_count + 1};
+    for (auto i : loop::end(rope.size()))
+    {
+        rope.particles[i].pos = {0.1 * static_cast<f64>(i), 0.0};
+    }
+    rope.particles[0].mass = std::numeric_limits<f64>::infinity();
+
+    auto springs = SpringSystem<f64>{};
+    for (auto i : loop::end(static_cast<u32>(link_count)))
+    {
+        springs.add(rope.particles, i, i + 1, stiffness, 0.0);
+    }
+    return std::pair{rope, springs};
+}
+
+static auto all_finite(const Rope& rope)
+{
+    for (const auto& particle : rope.particles)
+    {
+        if (!std::isfinite(particle.pos.x) || !std::isfinite(particle.pos.y)) { return false; }
+    }
+    return true;
+}
+
+// largest strain over 2 seconds, simulated with one step per frame
+static auto simulate_xpbd(phys::XPBD<f64> xpbd)
+{
+    auto [rope, springs] = make_rope();
+    auto max_strain      = 0.0;
+    for (auto frame = 0; frame < 120; frame++)
+    {
+        rope.step(
+            frame_time, [](Rope& system) { system.apply_force({0.0, -9.8}); },
+            [&](Rope& system) { xpbd.solve(system.particles, springs, frame_time); });
+        max_strain = math::max(max_strain, phys::XPBD<f64>::max_strain(rope.particles, springs));
+    }
+    REQUIRE(all_finite(rope));
+    return max_strain;
+}
+
+TEST_CASE("phys::XPBD keeps a stiff rope near its rest length at one step per frame")
+{
+    // the equilibrium strain is about 2e-3, and the rest is what the iterations leave
+    REQUIRE(simulate_xpbd({.iterations = 200, .warm_start = 0.5}) < 1e-2);
+}
+
+TEST_CASE("phys::XPBD warm starting does not increase the error")
+{
+    const auto cold = simulate_xpbd({.iterations = 10});
+    const auto warm = simulate_xpbd({.iterations = 10, .warm_start = 0.5});
+    REQUIRE(warm <= cold);
+}
+
+TEST_CASE("phys::XPBD is stable where explicit springs are not")
+{
+    auto [rope, springs] = make_rope();
+    for (auto frame = 0; frame < 120; frame++)
+    {
+        rope.step(frame_time,
+                  [&](Rope& system)
+                  {
+                      system.apply_force({0.0, -9.8});
+                      springs.apply_forces(system.particles);
+                  });
+    }
+
+    // springs this stiff need thousands of explicit steps per frame
+    REQUIRE((!all_finite(rope) || phys::XPBD<f64>::max_strain(rope.particles, springs) > 1.0));
+}